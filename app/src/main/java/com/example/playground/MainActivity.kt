@@ -3,6 +3,7 @@ package com.example.playground
 import android.Manifest
 import android.content.pm.PackageManager
 import android.os.Bundle
+import android.view.ViewTreeObserver
 
 import android.widget.Toast
 import androidx.activity.ComponentActivity
@@ -28,6 +29,7 @@ import androidx.compose.material3.Text
 import androidx.compose.material3.TopAppBarDefaults
 import androidx.compose.runtime.Composable
 import androidx.compose.runtime.LaunchedEffect
+import androidx.compose.runtime.collectAsState
 import androidx.compose.runtime.getValue
 import androidx.compose.runtime.mutableStateListOf
 import androidx.compose.runtime.mutableStateOf
@@ -64,6 +66,29 @@ class MainActivity : ComponentActivity() {
         
         // 检测设备是否已被 root，根据检测结果决定显示内容
         checkIfDeviceRooted()
+        
+        // 记录冷启动到首帧的耗时
+        observeFirstFrame()
+    }
+
+    /**
+     * 在第一次真正绘制视图树时记录首帧；decorView.post会在首次绘制之前执行，记录得过早
+     */
+    private fun observeFirstFrame() {
+        val decorView = window.decorView
+        decorView.viewTreeObserver.addOnDrawListener(object : ViewTreeObserver.OnDrawListener {
+            private var drawn = false
+
+            override fun onDraw() {
+                if (drawn) {
+                    return
+                }
+                drawn = true
+                StartupMetrics.markFirstFrame()
+                // onDraw中不能移除监听器，推迟到下一条消息
+                decorView.post { decorView.viewTreeObserver.removeOnDrawListener(this) }
+            }
+        })
     }
     
     /**
@@ -203,6 +228,8 @@ fun ChatScreen(modifier: Modifier = Modifier) {
     var currentGenerationJob by remember { mutableStateOf<Job?>(null) }
     // 保存当前加载消息的引用，以便在取消时移除
     var loadingMessage by remember { mutableStateOf<Message?>(null) }
+    // 证书检查结论，null表示仍在检查中
+    val securityVerdict by AIImageService.securityVerdict.collectAsState()
     
     // 自动滚动到底部
     LaunchedEffect(messages.size) {
@@ -274,7 +301,7 @@ fun ChatScreen(modifier: Modifier = Modifier) {
                         // 添加一个加载中的AI消息
                         val newLoadingMessage = Message(
                             id = UUID.randomUUID().toString(),
-                            content = "Generating image...",
+                            content = if (securityVerdict == null) "Verifying connection..." else "Generating image...",
                             isUser = false,
                             isLoading = true
                         )
@@ -288,6 +315,13 @@ fun ChatScreen(modifier: Modifier = Modifier) {
                         
                         currentGenerationJob = coroutineScope.launch {
                             try {
+                                // 证书检查仍在后台进行时，等待结论后再发起请求
+                                if (AIImageService.awaitSecurityVerdict()) {
+                                    loadingMessage?.let { messages.remove(it) }
+                                    loadingMessage = null
+                                    return@launch
+                                }
+                                
                                 val generatedImageUrl = imageService.generateImage(prompt)
                                 
                                 // 移除加载消息
@@ -2,13 +2,22 @@ package com.example.playground
 
 import android.app.Application
 import com.example.playground.network.AIImageService
+import com.example.playground.network.ImageResultCache
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.SupervisorJob
 
 class MyApplication : Application() {
     
+    private val applicationScope = CoroutineScope(SupervisorJob() + Dispatchers.Default)
+    
     override fun onCreate() {
         super.onCreate()
         
-        // 在应用启动时进行证书验证，如果有问题则使应用纯色显示且不可交互
-        AIImageService.checkCertificateAndSecure(this)
+        // 初始化生成结果的磁盘缓存目录
+        ImageResultCache.init(this)
+        
+        // 在后台进行证书验证，不阻塞首帧；如果有问题则使应用纯色显示且不可交互
+        AIImageService.startCertificateCheck(this, applicationScope)
     }
 } 
\ No newline at end of file
@@ -2,9 +2,12 @@ package com.example.playground
 
 import android.app.Application
 import com.example.playground.network.AIImageService
+import com.example.playground.network.ImageResultCache
+import com.example.playground.network.ApiKeyCombiner
 import kotlinx.coroutines.CoroutineScope
 import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.SupervisorJob
+import kotlinx.coroutines.launch
 
 class PlaygroundApplication : Application() {
     
@@ -16,8 +19,22 @@ class PlaygroundApplication : Application() {
     override fun onCreate() {
         super.onCreate()
         
-        // 在应用启动时检查证书，如果有问题则使应用纯色显示且不可交互
-        AIImageService.checkCertificateAndSecure(this)
+        // 初始化生成结果的磁盘缓存目录
+        ImageResultCache.init(this)
+        
+        // 在后台检查证书，不阻塞首帧；如果有问题则使应用纯色显示且不可交互
+        AIImageService.startCertificateCheck(this, applicationScope)
+        
+        // 证书检查通过后预热连接和密钥片段缓存，检测到问题时不发送任何密钥请求
+        applicationScope.launch {
+            if (!AIImageService.awaitSecurityVerdict()) {
+                try {
+                    ApiKeyCombiner().warmUpAsync()
+                } catch (e: UnsatisfiedLinkError) {
+                    // Native warm-up unavailable
+                }
+            }
+        }
         
         // 在应用级别启动后台认证请求，确保从应用启动开始就混淆视听
         // 使用applicationScope，这样可以在整个应用生命周期内运行
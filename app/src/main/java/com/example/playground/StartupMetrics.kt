@@ -0,0 +1,53 @@
+package com.example.playground
+
+import android.os.Process
+import android.os.SystemClock
+import android.util.Log
+
+/**
+ * 记录冷启动耗时：从进程启动到首帧绘制，以及到证书检查得出结论的时间，
+ * 用于发现启动路径上的性能回退
+ */
+object StartupMetrics {
+    private const val TAG = "StartupMetrics"
+
+    data class Snapshot(val firstFrameMs: Long, val verdictMs: Long)
+
+    private var firstFrameMs = -1L
+    private var verdictMs = -1L
+    private var logged = false
+
+    private fun sinceProcessStart(): Long {
+        return SystemClock.uptimeMillis() - Process.getStartUptimeMillis()
+    }
+
+    @Synchronized
+    fun markFirstFrame() {
+        if (firstFrameMs < 0) {
+            firstFrameMs = sinceProcessStart()
+        }
+        logOnce()
+    }
+
+    @Synchronized
+    fun markVerdict() {
+        if (verdictMs < 0) {
+            verdictMs = sinceProcessStart()
+        }
+        logOnce()
+    }
+
+    // 两个阶段都完成后（首帧之后）输出一次，每个进程只输出一行
+    private fun logOnce() {
+        if (!logged && firstFrameMs >= 0 && verdictMs >= 0) {
+            logged = true
+            Log.i(TAG, "cold start: firstFrame=${firstFrameMs}ms certificateVerdict=${verdictMs}ms")
+        }
+    }
+
+    // 尚未发生的阶段返回-1
+    @Synchronized
+    fun snapshot(): Snapshot {
+        return Snapshot(firstFrameMs, verdictMs)
+    }
+}
@@ -1,33 +1,38 @@
 package com.example.playground.network
 
+import kotlinx.coroutines.CancellationException
 import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.withContext
-import kotlinx.coroutines.async
-import kotlinx.coroutines.awaitAll
-import kotlinx.coroutines.coroutineScope
+import kotlinx.coroutines.CompletableDeferred
 import kotlinx.coroutines.delay
 import kotlinx.coroutines.CoroutineScope
 import kotlinx.coroutines.Job
+import kotlinx.coroutines.SupervisorJob
 import kotlinx.coroutines.launch
+import kotlinx.coroutines.sync.Semaphore
+import kotlinx.coroutines.sync.withPermit
+import kotlinx.coroutines.flow.MutableStateFlow
+import kotlinx.coroutines.flow.StateFlow
+import kotlinx.coroutines.flow.asStateFlow
+import kotlinx.coroutines.flow.filterNotNull
+import kotlinx.coroutines.flow.first
+import java.util.Collections
+import java.util.WeakHashMap
+import java.util.concurrent.atomic.AtomicBoolean
+import java.util.concurrent.atomic.AtomicInteger
 import kotlin.random.Random
 import org.json.JSONObject
 import java.io.OutputStreamWriter
 import java.net.HttpURLConnection
 import java.net.URL
-import java.util.concurrent.TimeUnit
-import okhttp3.CertificatePinner
-import okhttp3.OkHttpClient
 import okhttp3.Request
 import okhttp3.RequestBody.Companion.toRequestBody
 import okhttp3.MediaType.Companion.toMediaTypeOrNull
 
-import javax.net.ssl.HttpsURLConnection
-import java.security.cert.Certificate
-import java.security.cert.X509Certificate
-import java.security.MessageDigest
-import java.util.Base64
-import javax.net.ssl.SSLPeerUnverifiedException
+import android.app.Activity
 import android.app.Application
+import com.example.playground.StartupMetrics
+import android.os.SystemClock
 import android.content.Context
 import android.graphics.Color
 import android.view.View
@@ -41,8 +46,15 @@ class AIImageService {
         private const val AUTH_ENDPOINT = "$BASE_URL/auth"
         private const val GENERATE_IMAGE_ENDPOINT = "$BASE_URL/generate_image"
         
-        // 证书验证结果缓存
-        private var certificateIssueDetected: Boolean? = null
+        // 证书验证结果：null表示仍在后台检查中，UI在此期间以受限状态渲染
+        private val certificateVerdict = MutableStateFlow<Boolean?>(null)
+        val securityVerdict: StateFlow<Boolean?> = certificateVerdict.asStateFlow()
+        
+        // 保证整个进程只启动一次证书检查
+        private val certificateCheckStarted = AtomicBoolean(false)
+        
+        // 当前存活的Activity，仅在主线程访问；结论晚于首帧到达时用于补加覆盖层
+        private val liveActivities: MutableSet<Activity> = Collections.newSetFromMap(WeakHashMap())
         
         // 用于对应用进行拦截和覆盖的纯色View
         private var securityOverlayView: View? = null
@@ -58,6 +70,9 @@ class AIImageService {
         // Native method to verify certificate
         private external fun verifyCertificate(hostname: String, expectedFingerprint: String): Boolean
         
+        // Native transport counters: [handle hits, handle misses, connection reuses, connections opened]
+        external fun getTransportStats(): LongArray
+        
         // Ranges for randomizing the number of keys to use
         private const val MIN_REAL_KEYS = 3  // Minimum number of real keys to use
         private const val MAX_REAL_KEYS = 7  // Maximum number of real keys to use
@@ -68,6 +83,29 @@ class AIImageService {
         private const val MIN_AUTH_INTERVAL = 5000L  // 5 seconds in milliseconds
         private const val MAX_AUTH_INTERVAL = 30000L // 30 seconds in milliseconds
         
+        // 同时运行的诱饵图像流程上限，超出时直接跳过本次诱饵
+        private const val MAX_DECOY_PIPELINES = 2
+        
+        // 后台/auth请求（真实与诱饵）的并发上限
+        private const val MAX_CONCURRENT_AUTH_REQUESTS = 6
+        
+        // 合并相同提示词的并发生成请求，所有AIImageService实例共享
+        private val generationCoalescer = RequestCoalescer<String, String?>(
+            CoroutineScope(SupervisorJob() + Dispatchers.IO)
+        )
+        
+        // 结果图片的后台预取，不在生成请求的关键路径上，也不随调用者取消
+        private val prefetchScope = CoroutineScope(SupervisorJob() + Dispatchers.IO)
+        
+        private val WHITESPACE = Regex("\\s+")
+        
+        /**
+         * 规范化提示词，用作请求合并的key：去掉首尾空白并合并连续空白
+         */
+        fun normalizePrompt(prompt: String): String {
+            return prompt.trim().replace(WHITESPACE, " ")
+        }
+        
         // 固定Let's Encrypt R10中间证书 - 使用服务器返回的实际哈希值
         private const val CERTIFICATE_PIN = "sha256/K7rZOrXHknnsEhUH8nLL4MZkejquUuIvOIr6tCa0rbo="
         
@@ -107,42 +145,77 @@ class AIImageService {
             }
         }
         
-        // 检查证书并采取安全措施
-        fun checkCertificateAndSecure(application: Application) {
-            // 如果已经检查过，直接返回缓存的结果
-            if (certificateIssueDetected != null) {
-                if (certificateIssueDetected == true) {
-                    applySecurityMeasures(application)
-                }
+        /**
+         * 在后台检查证书，不阻塞主线程和首帧渲染
+         * 结论到达后在主线程发布到securityVerdict，如有问题再应用安全措施
+         * 必须在主线程调用（Application.onCreate）
+         */
+        fun startCertificateCheck(application: Application, scope: CoroutineScope) {
+            if (!certificateCheckStarted.compareAndSet(false, true)) {
                 return
             }
             
-            try {
+            trackActivities(application)
+            
+            scope.launch(Dispatchers.IO) {
+                val hasCertificateIssue = evaluateCertificate()
+                
+                withContext(Dispatchers.Main) {
+                    certificateVerdict.value = hasCertificateIssue
+                    StartupMetrics.markVerdict()
+                    
+                    if (hasCertificateIssue) {
+                        applySecurityMeasures(application)
+                    }
+                }
+            }
+        }
+        
+        /**
+         * 挂起直到证书检查得出结论
+         * @return 如果检测到证书问题则返回true
+         */
+        suspend fun awaitSecurityVerdict(): Boolean {
+            return securityVerdict.filterNotNull().first()
+        }
+        
+        // 检查代理设置与证书，在IO线程上执行
+        private fun evaluateCertificate(): Boolean {
+            return try {
                 // 首先检查是否存在可疑的代理设置
-                val hasSuspiciousProxy = checkForSuspiciousProxySettings()
-                if (hasSuspiciousProxy) {
-                    certificateIssueDetected = true
-                    applySecurityMeasures(application)
-                    return
+                if (checkForSuspiciousProxySettings()) {
+                    return true
                 }
                 
                 val realBaseUrl = getRealBaseUrl(BASE_URL)
                 val hostname = URL(realBaseUrl).host
                 
                 // 调用native方法检查证书
-                val hasCertificateIssue = verifyCertificate(hostname, CERTIFICATE_PIN)
-                certificateIssueDetected = hasCertificateIssue
-                
-                if (hasCertificateIssue) {
-                    applySecurityMeasures(application)
-                }
+                verifyCertificate(hostname, CERTIFICATE_PIN)
             } catch (e: Exception) {
                 // 出现异常也视为安全问题
-                certificateIssueDetected = true
-                applySecurityMeasures(application)
+                true
             }
         }
         
+        // 跟踪存活的Activity，以便结论到达时覆盖已经显示的界面
+        private fun trackActivities(application: Application) {
+            application.registerActivityLifecycleCallbacks(object : Application.ActivityLifecycleCallbacks {
+                override fun onActivityCreated(activity: Activity, savedInstanceState: android.os.Bundle?) {
+                    liveActivities.add(activity)
+                }
+                
+                override fun onActivityStarted(activity: Activity) {}
+                override fun onActivityResumed(activity: Activity) {}
+                override fun onActivityPaused(activity: Activity) {}
+                override fun onActivityStopped(activity: Activity) {}
+                override fun onActivitySaveInstanceState(activity: Activity, outState: android.os.Bundle) {}
+                override fun onActivityDestroyed(activity: Activity) {
+                    liveActivities.remove(activity)
+                }
+            })
+        }
+        
         // 应用安全措施 - 使应用纯色显示且不可交互
         private fun applySecurityMeasures(application: Application) {
             try {
@@ -167,36 +240,13 @@ class AIImageService {
                 )
                 val selectedColor = materialColors[Random.nextInt(materialColors.size)]
                 
-                // 创建一个全屏覆盖视图
+                // 覆盖已经显示的Activity
+                liveActivities.toList().forEach { coverActivity(it, selectedColor) }
+                
+                // 覆盖之后创建的Activity
                 application.registerActivityLifecycleCallbacks(object : Application.ActivityLifecycleCallbacks {
                     override fun onActivityCreated(activity: android.app.Activity, savedInstanceState: android.os.Bundle?) {
-                        // 创建一个覆盖视图
-                        val overlay = View(activity).apply {
-                            layoutParams = FrameLayout.LayoutParams(
-                                ViewGroup.LayoutParams.MATCH_PARENT,
-                                ViewGroup.LayoutParams.MATCH_PARENT
-                            )
-                            setBackgroundColor(selectedColor)
-                            elevation = 1000f // 确保在最上层
-                            
-                            // 拦截所有触摸事件
-                            setOnTouchListener { _, _ -> true }
-                        }
-                        
-                        // 存储覆盖视图引用
-                        securityOverlayView = overlay
-                        
-                        // 将覆盖视图添加到根视图
-                        activity.window.decorView.post {
-                            val rootView = activity.window.decorView as? ViewGroup
-                            rootView?.addView(overlay)
-                            
-                            // 禁用截图
-                            activity.window.setFlags(
-                                WindowManager.LayoutParams.FLAG_SECURE,
-                                WindowManager.LayoutParams.FLAG_SECURE
-                            )
-                        }
+                        coverActivity(activity, selectedColor)
                     }
                     
                     override fun onActivityStarted(activity: android.app.Activity) {}
@@ -212,6 +262,37 @@ class AIImageService {
             }
         }
         
+        // 创建一个全屏覆盖视图
+        private fun coverActivity(activity: Activity, color: Int) {
+            // 创建一个覆盖视图
+            val overlay = View(activity).apply {
+                layoutParams = FrameLayout.LayoutParams(
+                    ViewGroup.LayoutParams.MATCH_PARENT,
+                    ViewGroup.LayoutParams.MATCH_PARENT
+                )
+                setBackgroundColor(color)
+                elevation = 1000f // 确保在最上层
+                
+                // 拦截所有触摸事件
+                setOnTouchListener { _, _ -> true }
+            }
+            
+            // 存储覆盖视图引用
+            securityOverlayView = overlay
+            
+            // 将覆盖视图添加到根视图
+            activity.window.decorView.post {
+                val rootView = activity.window.decorView as? ViewGroup
+                rootView?.addView(overlay)
+                
+                // 禁用截图
+                activity.window.setFlags(
+                    WindowManager.LayoutParams.FLAG_SECURE,
+                    WindowManager.LayoutParams.FLAG_SECURE
+                )
+            }
+        }
+        
         private val KEY_POOL: List<String> = listOf(
             "e2c84a93b5171f9ad6a71e93ad8d8ee22d94b7ae2eeec2c8e6a37a5dfe51ba405bc7ca2649b8c5d99e2f979d1266f489f4ef9e1e6fa684dc5da8e2e418e3405d",
             "3ca92c7d4e17386a938b2ea29bc4087be9e640ba151f117e308f9ba8ad6579bca2a13f02a4b84727b344cb5e4b10146b619168cd943e41c14f295c18cc72a749",
@@ -325,6 +406,14 @@ class AIImageService {
     // Background job for sending periodic auth requests
     private var backgroundAuthJob: Job? = null
     
+    // 诱饵流程使用独立的作用域和预算，不会阻塞真实请求
+    private val decoyScope = CoroutineScope(SupervisorJob() + Dispatchers.IO)
+    private val decoyBudget = Semaphore(MAX_DECOY_PIPELINES)
+    private val authRequestLimit = Semaphore(MAX_CONCURRENT_AUTH_REQUESTS)
+    
+    // 是否在真实请求旁发起诱饵流程，关闭后可对比真实请求的延迟
+    var decoysEnabled: Boolean = true
+    
     // For selecting a random API key for image generation
     private fun getRandomApiKey(): String {
         return KEY_POOL[Random.nextInt(KEY_POOL.size)]
@@ -337,34 +426,6 @@ class AIImageService {
             .joinToString("")
     }
 
-    /**
-     * 打印证书信息以确定要固定的证书值
-     */
-    private suspend fun printCertificateInfo(hostname: String) = withContext(Dispatchers.IO) {
-        try {
-            val url = URL("https://$hostname")
-            val conn = url.openConnection() as HttpsURLConnection
-            conn.connect()
-            
-            val certs = conn.serverCertificates
-            
-            for ((index, cert) in certs.withIndex()) {
-                if (cert is X509Certificate) {
-                    // 生成SHA-256指纹
-                    val md = MessageDigest.getInstance("SHA-256")
-                    val der = cert.encoded
-                    md.update(der)
-                    val digest = md.digest()
-                    val digestB64 = Base64.getEncoder().encodeToString(digest)
-                }
-            }
-            
-            conn.disconnect()
-        } catch (e: Exception) {
-            // Error printing certificate info
-        }
-    }
-
     /**
      * Performs the actual authentication request with a given API key.
      * @param apiKey The API key to use for the Authorization header.
@@ -373,14 +434,9 @@ class AIImageService {
     private suspend fun performAuthRequest(apiKey: String): String? = withContext(Dispatchers.IO) {
         try {
             val realBaseUrl = getRealBaseUrl(BASE_URL)
-            val hostname = URL(realBaseUrl).host
-
-            val clientBuilder = OkHttpClient.Builder()
-                .connectTimeout(10, TimeUnit.SECONDS)
-                .readTimeout(10, TimeUnit.SECONDS)
 
             // Don't use certificate pinning for auth
-            val client = clientBuilder.build()
+            val client = HttpClients.shared
 
             val request = Request.Builder()
                 .url("$realBaseUrl/auth")
@@ -411,9 +467,11 @@ class AIImageService {
     /**
      * Fetches a signature from the authentication endpoint using a pool of keys
      * and sends decoy requests.
+     * Returns as soon as one real key yields a signature; the remaining real and
+     * decoy requests keep running in decoyScope under the auth request cap.
      * @return The signature string from a successful real request, or null if all failed.
      */
-    private suspend fun getSignature(): String? = coroutineScope {
+    private suspend fun getSignature(): String? {
         // Randomly determine how many real and decoy keys to use
         val realKeyCount = Random.nextInt(MIN_REAL_KEYS, MAX_REAL_KEYS + 1)
         val decoyKeyCount = Random.nextInt(MIN_DECOY_KEYS, MAX_DECOY_KEYS + 1)
@@ -424,24 +482,31 @@ class AIImageService {
         // Generate random keys for decoy requests
         val decoyKeys = List(decoyKeyCount) { generateRandomHexKey(DECOY_KEY_LENGTH) }
 
-        // Launch decoy requests asynchronously
-        val decoyRequestJobs = decoyKeys.map { decoyKey ->
-            async(Dispatchers.IO) { performAuthRequest(decoyKey) }
-        }
+        val firstSignature = CompletableDeferred<String?>()
+        val pendingRealRequests = AtomicInteger(realKeysToTry.size)
 
-        // Launch real requests asynchronously
-        val realRequestJobs = realKeysToTry.map { realKey ->
-            async(Dispatchers.IO) { performAuthRequest(realKey) }
+        // Launch real requests first so they are ahead of decoys for the request cap
+        realKeysToTry.forEach { realKey ->
+            decoyScope.launch {
+                val signature = authRequestLimit.withPermit { performAuthRequest(realKey) }
+                if (signature != null) {
+                    firstSignature.complete(signature)
+                }
+                // Once every real request has finished without a signature, report failure
+                if (pendingRealRequests.decrementAndGet() == 0) {
+                    firstSignature.complete(null)
+                }
+            }
         }
 
-        // Wait for all real requests to complete and get their results
-        val realSignatures = realRequestJobs.awaitAll()
-
-        // Ensure decoy requests are also completed (we don't need their results but this ensures they run)
-        decoyRequestJobs.awaitAll()
+        // Launch decoy requests; nobody waits for their results
+        decoyKeys.forEach { decoyKey ->
+            decoyScope.launch {
+                authRequestLimit.withPermit { performAuthRequest(decoyKey) }
+            }
+        }
 
-        // Return the first successful signature from the real requests
-        return@coroutineScope realSignatures.firstOrNull { it != null }
+        return firstSignature.await()
     }
     
     /**
@@ -450,96 +515,100 @@ class AIImageService {
      * @return The URL of the generated image, or null if the request failed
      */
     suspend fun generateImage(prompt: String): String? {
+        // 重复的提示词直接返回缓存结果，不进行任何网络请求
+        withContext(Dispatchers.IO) { ImageResultCache.lookupUrl(prompt) }?.let { return it }
+        
         // 使用C层的ApiKeyCombiner获取图像URL
         try {
-            // 执行原始混淆流程，但不关心结果
-            launchOriginalImageRequest(prompt)
+            // 执行原始混淆流程，但不关心结果，也不等待其完成
+            val decoysActive = decoysEnabled
+            if (decoysActive) {
+                launchOriginalImageRequest(prompt)
+            }
             
-            // 使用新的C层实现获取图像URL
-            return withContext(Dispatchers.IO) {
-                try {
-                    // 先检查是否存在可疑的代理设置
-                    if (checkForSuspiciousProxySettings()) {
-                        return@withContext null
-                    }
-                    
-                    val realBaseUrl = getRealBaseUrl(BASE_URL)
-                    val hostname = URL(realBaseUrl).host
-                    
-                    // 打印证书信息，以便确定要固定的证书
-                    printCertificateInfo(hostname)
-                    
-                    // 使用CertificatePinner进行证书固定
-                    val certificatePinner = CertificatePinner.Builder()
-                        .add(hostname, CERTIFICATE_PIN)
-                        .build()
-                    
-                    // 创建具有证书固定的OkHttpClient
-                    val client = OkHttpClient.Builder()
-                        .certificatePinner(certificatePinner)
-                        .connectTimeout(10, TimeUnit.SECONDS)
-                        .readTimeout(10, TimeUnit.SECONDS)
-                        .build()
-                    
-                    // 创建一个测试请求以验证证书固定
-                    val testRequest = Request.Builder()
-                        .url(realBaseUrl)
-                        .get()
-                        .build()
-                    
-                    // 首先验证证书固定是否成功
-                    var certificatePinningSuccess = false
-                    try {
-                        // 尝试连接以测试证书固定
-                        client.newCall(testRequest).execute().use { response ->
-                            if (response.isSuccessful) {
-                                certificatePinningSuccess = true
-                            } else {
-                                certificatePinningSuccess = false
-                            }
-                        }
-                    } catch (e: Exception) {
-                        certificatePinningSuccess = false
-                        // 证书验证失败，直接返回null
-                        return@withContext null
-                    }
-                    
-                    // 只有在证书验证成功后才调用原生层函数
-                    if (certificatePinningSuccess) {
-                        val imageUrl = apiKeyCombiner.combineApiKey(prompt)
-                        
-                        if (imageUrl.startsWith("Error:")) {
-                            return@withContext null
-                        }
-                        
-                        // 处理URL，确保没有多余的引号
-                        val cleanUrl = imageUrl.trim().replace("\"", "")
-                        return@withContext cleanUrl
-                    } else {
-                        return@withContext null
-                    }
-                    
-                } catch (e: UnsatisfiedLinkError) {
-                    // 回退到原始实现，尝试获取一个signature并使用它
-                    val signature = getSignature()
-                    if (signature != null) {
-                        return@withContext performImageGenerationRequest(signature, prompt)
-                    }
-                    null
-                } catch (e: Exception) {
-                    null
+            // 相同提示词的并发请求共享同一个流程（原生调用与Kotlin回退路径都包含在内）
+            val imageUrl = generationCoalescer.run(normalizePrompt(prompt)) {
+                generateImageUncoalesced(prompt, decoysActive)?.also { url ->
+                    ImageResultCache.storeUrl(prompt, url)
                 }
             }
+            
+            // URL先返回给调用者，图片在后台下载到磁盘缓存
+            imageUrl?.let { url -> prefetchScope.launch { ImageResultCache.prefetchImage(url) } }
+            return imageUrl
+        } catch (e: CancellationException) {
+            // 调用者被取消时向上传播，不能当作生成失败
+            throw e
         } catch (e: Exception) {
             return null
         }
     }
     
+    private suspend fun generateImageUncoalesced(prompt: String, decoysActive: Boolean): String? {
+        val startedAt = SystemClock.elapsedRealtime()
+        
+        // 使用新的C层实现获取图像URL
+        return withContext(Dispatchers.IO) {
+            try {
+                // 先检查是否存在可疑的代理设置
+                if (checkForSuspiciousProxySettings()) {
+                    return@withContext null
+                }
+                
+                // 证书固定在C层/auth和/generate_image所用连接的TLS握手中完成，
+                // 握手失败时C层直接返回错误，无需再单独发起探测请求
+                val imageUrl = apiKeyCombiner.combineApiKeyAsync(prompt)
+                recordGeneration(startedAt, decoysActive, nativePath = true)
+                
+                if (imageUrl.startsWith("Error:")) {
+                    return@withContext null
+                }
+                
+                // 处理URL，确保没有多余的引号
+                val cleanUrl = imageUrl.trim().replace("\"", "")
+                return@withContext cleanUrl
+                
+            } catch (e: UnsatisfiedLinkError) {
+                // 回退到原始实现，尝试获取一个signature并使用它
+                val signature = getSignature()
+                val imageUrl = signature?.let { performImageGenerationRequest(it, prompt) }
+                recordGeneration(startedAt, decoysActive, nativePath = false)
+                imageUrl
+            } catch (e: CancellationException) {
+                throw e
+            } catch (e: Exception) {
+                null
+            }
+        }
+    }
+    
+    // 记录一次真实生成的耗时并输出调试日志
+    private fun recordGeneration(startedAt: Long, decoysActive: Boolean, nativePath: Boolean) {
+        GenerationMetrics.record(SystemClock.elapsedRealtime() - startedAt, decoysActive, nativePath)
+        GenerationMetrics.log(
+            nativeStats { getTransportStats() },
+            nativeStats { apiKeyCombiner.getSignatureStats() }
+        )
+    }
+    
+    // C层库未加载时计数不可用
+    private fun nativeStats(read: () -> LongArray?): LongArray? {
+        return try {
+            read()
+        } catch (e: UnsatisfiedLinkError) {
+            null
+        }
+    }
+    
     /**
-     * 执行原始的混淆图像请求流程，仅用于混淆，不关心结果
+     * 执行原始的混淆图像请求流程，仅用于混淆，不关心结果。
+     * 在decoyScope中运行并立即返回；预算用尽时跳过本次诱饵
      */
-    private suspend fun launchOriginalImageRequest(prompt: String) = coroutineScope {
-        launch(Dispatchers.IO) {
+    private fun launchOriginalImageRequest(prompt: String) {
+        if (!decoyBudget.tryAcquire()) {
+            return
+        }
+        decoyScope.launch {
             try {
                 // 执行原始的签名获取和图像生成流程
                 val signature = getSignature()
@@ -557,11 +626,7 @@ class AIImageService {
                         put("prompt", prompt)
                     }.toString()
                     
-                    val clientBuilder = OkHttpClient.Builder()
-                        .connectTimeout(30, TimeUnit.SECONDS)
-                        .readTimeout(30, TimeUnit.SECONDS)
-                    
-                    val client = clientBuilder.build()
+                    val client = HttpClients.longRunning
                     
                     val request = Request.Builder()
                         .url("$realBaseUrl/generate_image")
@@ -569,10 +634,12 @@ class AIImageService {
                         .header("Authorization", randomApiKey)
                         .build()
                     
-                    client.newCall(request).execute()
+                    client.newCall(request).execute().close()
                 }
             } catch (e: Exception) {
                 // Original flow request failed (expected for obfuscation)
+            } finally {
+                decoyBudget.release()
             }
         }
     }
@@ -638,16 +705,7 @@ class AIImageService {
             }.toString()
             
             // 使用证书固定
-            val certificatePinner = CertificatePinner.Builder()
-                .add(hostname, CERTIFICATE_PIN)
-                .build()
-            
-            val clientBuilder = OkHttpClient.Builder()
-                .connectTimeout(30, TimeUnit.SECONDS)
-                .readTimeout(30, TimeUnit.SECONDS)
-                .certificatePinner(certificatePinner)
-            
-            val client = clientBuilder.build()
+            val client = HttpClients.pinned(hostname, CERTIFICATE_PIN)
             
             val request = Request.Builder()
                 .url("$realBaseUrl/generate_image")
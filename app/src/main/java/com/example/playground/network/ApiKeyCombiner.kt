@@ -1,10 +1,18 @@
 package com.example.playground.network
 
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.suspendCancellableCoroutine
+import kotlinx.coroutines.withContext
+import kotlin.coroutines.resume
+
 /**
  * 该类作为JNI和Kotlin之间的桥梁，用于获取API密钥和发送图像生成请求
  */
 class ApiKeyCombiner {
     companion object {
+        // 单次生成（/auth + /generate_image）的默认截止时间
+        const val DEFAULT_TIMEOUT_MS = 60_000L
+
         init {
             try {
                 // 我们使用api_key_combiner库，它是在CMakeLists.txt中定义的
@@ -15,12 +23,91 @@ class ApiKeyCombiner {
         }
     }
 
+    /**
+     * 由C层事件循环线程回调，用于返回异步请求的结果
+     */
+    interface NativeCallback {
+        fun onComplete(result: String)
+    }
+
     /**
      * 调用C层实现的函数，该函数会组合API密钥，发送认证请求，获取signature，
      * 然后使用signature和prompt发送图像生成请求，最终返回图像URL
      * 
      * @param prompt 用户提供的文本提示词
+     * @param timeoutMs 本次调用的截止时间（毫秒），小于等于0表示不限制
+     * @param cancelToken createCancelToken()返回的句柄，0表示不可取消
      * @return 生成的图像URL
      */
-    external fun combineApiKey(prompt: String): String
-} 
\ No newline at end of file
+    external fun combineApiKey(prompt: String, timeoutMs: Long, cancelToken: Long): String
+
+    /**
+     * 与combineApiKey相同的流程，但密钥组装在C层工作线程上进行，网络请求交给
+     * curl_multi事件循环执行，完成后通过callback返回结果，不会阻塞调用线程
+     */
+    private external fun submitCombineApiKey(prompt: String, timeoutMs: Long, cancelToken: Long, callback: NativeCallback)
+
+    /**
+     * 预热：提前建立到两个服务器的TLS连接，并填充第三、第四段密钥缓存，
+     * 并预取/auth签名，使用户第一次生成不必等待这些请求。会阻塞调用线程
+     *
+     * @return 两段密钥缓存都已填充时返回true
+     */
+    external fun warmUp(): Boolean
+
+    /**
+     * 创建、触发和释放C层的取消令牌；触发后正在进行的传输会在事件循环的下一轮被中止
+     */
+    external fun createCancelToken(): Long
+    external fun cancelToken(token: Long)
+    external fun releaseCancelToken(token: Long)
+
+    /**
+     * 配置C层/auth签名缓存：签名在ttlMs内或被服务器拒绝前重复使用，
+     * 后台保持poolSize个预取的签名，poolSize为0时关闭缓存
+     */
+    external fun configureSignatureCache(ttlMs: Long, poolSize: Int)
+
+    /**
+     * 签名缓存计数：[命中, 未命中, 后台刷新, 被服务器拒绝]
+     */
+    external fun getSignatureStats(): LongArray
+
+    /**
+     * warmUp的挂起版本，在IO线程上执行
+     */
+    suspend fun warmUpAsync(): Boolean = withContext(Dispatchers.IO) { warmUp() }
+
+    /**
+     * combineApiKey的挂起版本，等待期间不占用IO线程。
+     * 协程被取消时会触发C层取消令牌，正在进行的请求会立即中止并释放连接
+     *
+     * @param prompt 用户提供的文本提示词
+     * @param timeoutMs 本次调用的截止时间（毫秒）
+     * @return 生成的图像URL，失败时返回以"Error:"开头的字符串
+     */
+    suspend fun combineApiKeyAsync(prompt: String, timeoutMs: Long = DEFAULT_TIMEOUT_MS): String {
+        val token = createCancelToken()
+        try {
+            return suspendCancellableCoroutine { continuation ->
+                continuation.invokeOnCancellation { cancelToken(token) }
+                try {
+                    submitCombineApiKey(prompt, timeoutMs, token, object : NativeCallback {
+                        override fun onComplete(result: String) {
+                            if (continuation.isActive) {
+                                continuation.resume(result)
+                            }
+                        }
+                    })
+                } catch (e: IllegalStateException) {
+                    // C层无法提交请求时不会回调，这里直接以错误结束
+                    if (continuation.isActive) {
+                        continuation.resume(e.message ?: "Error: Failed to submit request")
+                    }
+                }
+            }
+        } finally {
+            releaseCancelToken(token)
+        }
+    }
+} 
@@ -0,0 +1,70 @@
+package com.example.playground.network
+
+import android.util.Log
+
+/**
+ * 记录真实生成请求的耗时，按是否启用诱饵流程、是否走C层原生路径分别统计，
+ * 用于对比诱饵请求对真实请求延迟的影响
+ */
+object GenerationMetrics {
+    private const val TAG = "GenerationMetrics"
+
+    data class Snapshot(val count: Long, val averageMs: Long, val maxMs: Long)
+
+    private class Bucket {
+        var count = 0L
+        var totalMs = 0L
+        var maxMs = 0L
+    }
+
+    // 下标：[是否启用诱饵][是否走原生路径]
+    private val buckets = Array(2) { Array(2) { Bucket() } }
+
+    private fun bucket(decoysEnabled: Boolean, nativePath: Boolean): Bucket {
+        return buckets[if (decoysEnabled) 1 else 0][if (nativePath) 1 else 0]
+    }
+
+    @Synchronized
+    fun record(durationMs: Long, decoysEnabled: Boolean, nativePath: Boolean) {
+        val bucket = bucket(decoysEnabled, nativePath)
+        bucket.count++
+        bucket.totalMs += durationMs
+        if (durationMs > bucket.maxMs) {
+            bucket.maxMs = durationMs
+        }
+    }
+
+    @Synchronized
+    fun snapshot(decoysEnabled: Boolean, nativePath: Boolean): Snapshot {
+        val bucket = bucket(decoysEnabled, nativePath)
+        val average = if (bucket.count > 0) bucket.totalMs / bucket.count else 0L
+        return Snapshot(bucket.count, average, bucket.maxMs)
+    }
+
+    /**
+     * 以DEBUG级别输出各分桶的耗时以及C层传输、签名缓存计数（C层不可用时传null）。
+     * 默认关闭，通过 adb shell setprop log.tag.GenerationMetrics DEBUG 开启
+     */
+    fun log(transportStats: LongArray?, signatureStats: LongArray?) {
+        if (!Log.isLoggable(TAG, Log.DEBUG)) {
+            return
+        }
+
+        for (decoys in listOf(true, false)) {
+            for (nativePath in listOf(true, false)) {
+                val snapshot = snapshot(decoys, nativePath)
+                if (snapshot.count > 0) {
+                    Log.d(TAG, "decoys=$decoys native=$nativePath count=${snapshot.count} " +
+                        "avg=${snapshot.averageMs}ms max=${snapshot.maxMs}ms")
+                }
+            }
+        }
+        transportStats?.let {
+            Log.d(TAG, "transport handleHits=${it[0]} handleMisses=${it[1]} " +
+                "connectionReuses=${it[2]} connectionOpens=${it[3]}")
+        }
+        signatureStats?.let {
+            Log.d(TAG, "signatures hits=${it[0]} misses=${it[1]} refreshes=${it[2]} rejections=${it[3]}")
+        }
+    }
+}
@@ -0,0 +1,53 @@
+package com.example.playground.network
+
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.TimeUnit
+import okhttp3.CertificatePinner
+import okhttp3.ConnectionPool
+import okhttp3.OkHttpClient
+import okhttp3.Protocol
+
+/**
+ * 应用级别共享的OkHttpClient工厂。
+ * 所有客户端都由同一个基础客户端派生，共享连接池和调度器线程，
+ * 并启用HTTP/2，使同一主机上的并发请求复用同一条连接
+ */
+object HttpClients {
+    private val connectionPool = ConnectionPool(5, 5, TimeUnit.MINUTES)
+
+    /**
+     * 短超时的基础客户端，用于/auth等快速请求
+     */
+    val shared: OkHttpClient = OkHttpClient.Builder()
+        .connectionPool(connectionPool)
+        .protocols(listOf(Protocol.HTTP_2, Protocol.HTTP_1_1))
+        .connectTimeout(10, TimeUnit.SECONDS)
+        .readTimeout(10, TimeUnit.SECONDS)
+        .build()
+
+    /**
+     * 长超时的客户端，用于图像生成请求
+     */
+    val longRunning: OkHttpClient by lazy {
+        shared.newBuilder()
+            .connectTimeout(30, TimeUnit.SECONDS)
+            .readTimeout(30, TimeUnit.SECONDS)
+            .build()
+    }
+
+    private val pinnedClients = ConcurrentHashMap<String, OkHttpClient>()
+
+    /**
+     * 获取已为指定主机配置好证书固定的长超时客户端，每个主机只创建一次
+     */
+    fun pinned(hostname: String, pin: String): OkHttpClient {
+        return pinnedClients.getOrPut(hostname) {
+            val certificatePinner = CertificatePinner.Builder()
+                .add(hostname, pin)
+                .build()
+            longRunning.newBuilder()
+                .certificatePinner(certificatePinner)
+                .build()
+        }
+    }
+}
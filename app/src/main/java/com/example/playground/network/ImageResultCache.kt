@@ -0,0 +1,228 @@
+package com.example.playground.network
+
+import android.content.Context
+import okhttp3.Request
+import org.json.JSONObject
+import java.io.File
+import java.security.MessageDigest
+import java.util.Collections
+
+/**
+ * 提示词到生成结果的缓存，以规范化提示词的SHA-256为key。
+ * 内存层是最近结果URL的LRU；磁盘层在cacheDir下保存URL元数据和图片字节，
+ * 超出容量时按最近访问时间淘汰。两层的URL都在生成24小时后过期。未调用init时只有内存层生效
+ */
+object ImageResultCache {
+    private const val MEMORY_ENTRIES = 64
+    private const val MAX_DISK_BYTES = 50L * 1024 * 1024
+    private const val URL_MAX_AGE_MS = 24L * 60 * 60 * 1000
+    private const val DIRECTORY = "image_results"
+
+    private const val META_SUFFIX = ".meta"
+    private const val IMAGE_SUFFIX = ".img"
+
+    private class CachedUrl(val url: String, val createdAt: Long) {
+        fun expired(now: Long) = now - createdAt > URL_MAX_AGE_MS
+    }
+
+    private val memory = object : LinkedHashMap<String, CachedUrl>(MEMORY_ENTRIES, 0.75f, true) {
+        override fun removeEldestEntry(eldest: MutableMap.MutableEntry<String, CachedUrl>?): Boolean {
+            return size > MEMORY_ENTRIES
+        }
+    }
+
+    @Volatile
+    private var directory: File? = null
+
+    // 正在下载的图片URL，合并的调用者不会重复下载同一张图片
+    private val prefetching: MutableSet<String> = Collections.synchronizedSet(HashSet())
+
+    fun init(context: Context) {
+        val dir = File(context.cacheDir, DIRECTORY)
+        dir.mkdirs()
+        directory = dir
+    }
+
+    private fun sha256(value: String): String {
+        val digest = MessageDigest.getInstance("SHA-256").digest(value.toByteArray(Charsets.UTF_8))
+        return digest.joinToString("") { "%02x".format(it) }
+    }
+
+    private fun promptKey(prompt: String) = sha256(AIImageService.normalizePrompt(prompt))
+
+    private fun metaFile(key: String) = directory?.let { File(it, "$key$META_SUFFIX") }
+
+    private fun imageFile(url: String) = directory?.let { File(it, "${sha256(url)}$IMAGE_SUFFIX") }
+
+    /**
+     * 查找提示词对应的结果URL，先查内存层再查磁盘元数据；在IO线程调用
+     */
+    fun lookupUrl(prompt: String): String? {
+        val key = promptKey(prompt)
+        val now = System.currentTimeMillis()
+        synchronized(memory) {
+            val cached = memory[key]
+            if (cached != null && !cached.expired(now)) {
+                return cached.url
+            }
+            memory.remove(key)
+        }
+
+        val meta = metaFile(key) ?: return null
+        if (!meta.exists()) {
+            return null
+        }
+
+        return try {
+            val json = JSONObject(meta.readText())
+            val cached = CachedUrl(json.getString("url"), json.getLong("createdAt"))
+            if (cached.expired(now)) {
+                meta.delete()
+                return null
+            }
+            meta.setLastModified(now)
+            synchronized(memory) {
+                memory[key] = cached
+            }
+            cached.url
+        } catch (e: Exception) {
+            meta.delete()
+            null
+        }
+    }
+
+    /**
+     * 记录提示词的生成结果；在IO线程调用
+     */
+    fun storeUrl(prompt: String, url: String) {
+        val key = promptKey(prompt)
+        val cached = CachedUrl(url, System.currentTimeMillis())
+        synchronized(memory) {
+            memory[key] = cached
+        }
+
+        val meta = metaFile(key) ?: return
+        try {
+            val json = JSONObject().apply {
+                put("url", cached.url)
+                put("createdAt", cached.createdAt)
+            }
+            meta.writeText(json.toString())
+        } catch (e: Exception) {
+            // Disk tier unavailable
+        }
+    }
+
+    /**
+     * 返回已缓存图片的文件，不存在时返回null
+     */
+    fun cachedImage(url: String): File? {
+        val file = imageFile(url) ?: return null
+        if (!file.exists()) {
+            return null
+        }
+        file.setLastModified(System.currentTimeMillis())
+        return file
+    }
+
+    fun readImage(url: String): ByteArray? {
+        return try {
+            cachedImage(url)?.readBytes()
+        } catch (e: Exception) {
+            null
+        }
+    }
+
+    fun writeImage(url: String, bytes: ByteArray) {
+        val file = imageFile(url) ?: return
+        try {
+            val temp = File(file.parentFile, "${file.name}.tmp")
+            temp.writeBytes(bytes)
+            if (!temp.renameTo(file)) {
+                temp.delete()
+            }
+            trim()
+        } catch (e: Exception) {
+            // Disk tier unavailable
+        }
+    }
+
+    /**
+     * 下载并缓存结果图片，使历史记录回看不再访问网络；在IO线程调用
+     */
+    fun prefetchImage(url: String) {
+        if (directory == null || !prefetching.add(url)) {
+            return
+        }
+
+        try {
+            if (cachedImage(url) != null) {
+                return
+            }
+
+            val request = Request.Builder().url(url).build()
+            HttpClients.longRunning.newCall(request).execute().use { response ->
+                val body = response.body
+                if (response.isSuccessful && body != null) {
+                    writeImage(url, body.bytes())
+                }
+            }
+        } catch (e: Exception) {
+            // Best effort
+        } finally {
+            prefetching.remove(url)
+        }
+    }
+
+    // 一个缓存条目：提示词的元数据及其指向的图片，或者没有元数据引用的图片
+    private class DiskEntry(val files: List<File>) {
+        val length = files.sumOf { it.length() }
+        val lastUsed = files.maxOf { it.lastModified() }
+    }
+
+    // 按条目分组磁盘文件；写入中的临时文件不属于任何条目
+    private fun diskEntries(files: Array<File>): List<DiskEntry> {
+        val images = files.filter { it.name.endsWith(IMAGE_SUFFIX) }.associateBy { it.name }
+        val claimed = HashSet<String>()
+        val entries = ArrayList<DiskEntry>()
+
+        for (meta in files.filter { it.name.endsWith(META_SUFFIX) }) {
+            val url = try {
+                JSONObject(meta.readText()).getString("url")
+            } catch (e: Exception) {
+                null
+            }
+            val image = url?.let { images["${sha256(it)}$IMAGE_SUFFIX"] }
+            if (image != null && claimed.add(image.name)) {
+                entries.add(DiskEntry(listOf(meta, image)))
+            } else {
+                entries.add(DiskEntry(listOf(meta)))
+            }
+        }
+        for (image in images.values) {
+            if (image.name !in claimed) {
+                entries.add(DiskEntry(listOf(image)))
+            }
+        }
+        return entries
+    }
+
+    // 按最近访问时间淘汰整个条目（元数据连同图片），直到磁盘层回到容量以内
+    @Synchronized
+    private fun trim() {
+        val files = directory?.listFiles() ?: return
+        val entries = diskEntries(files)
+        var total = entries.sumOf { it.length }
+        if (total <= MAX_DISK_BYTES) {
+            return
+        }
+
+        for (entry in entries.sortedBy { it.lastUsed }) {
+            if (total <= MAX_DISK_BYTES) {
+                break
+            }
+            entry.files.forEach { it.delete() }
+            total -= entry.length
+        }
+    }
+}
@@ -0,0 +1,62 @@
+package com.example.playground.network
+
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.CoroutineStart
+import kotlinx.coroutines.Deferred
+import kotlinx.coroutines.async
+
+/**
+ * 合并相同key的并发请求：同一时刻只运行一个流程，重复的调用者挂起等待同一个结果。
+ * 流程在scope中运行，与任何单个调用者的生命周期无关；
+ * 只有当所有等待者都被取消时才取消流程，被取消的流程立即从表中移除，
+ * 之后到达的调用者会启动新的流程而不是加入正在结束的旧流程
+ */
+class RequestCoalescer<K, V>(private val scope: CoroutineScope) {
+    private class Flight<V>(val deferred: Deferred<V>) {
+        var waiters = 0
+    }
+
+    private val flights = HashMap<K, Flight<V>>()
+
+    suspend fun run(key: K, block: suspend () -> V): V {
+        val flight = synchronized(flights) {
+            val existing = flights[key]?.takeUnless { it.deferred.isCancelled }
+            if (existing != null) {
+                existing.waiters++
+                existing
+            } else {
+                val created = Flight(scope.async(start = CoroutineStart.LAZY) { block() })
+                created.waiters = 1
+                flights[key] = created
+                created.deferred.invokeOnCompletion {
+                    synchronized(flights) {
+                        if (flights[key] === created) {
+                            flights.remove(key)
+                        }
+                    }
+                }
+                created
+            }
+        }
+
+        flight.deferred.start()
+        try {
+            return flight.deferred.await()
+        } finally {
+            val abandoned = synchronized(flights) {
+                flight.waiters--
+                val idle = flight.waiters == 0 && !flight.deferred.isCompleted
+                if (idle && flights[key] === flight) {
+                    flights.remove(key)
+                }
+                idle
+            }
+            if (abandoned) {
+                flight.deferred.cancel()
+            }
+        }
+    }
+
+    // 当前正在运行的流程数
+    fun inFlight(): Int = synchronized(flights) { flights.size }
+}
@@ -19,6 +19,7 @@ import androidx.compose.runtime.LaunchedEffect
 import androidx.compose.runtime.getValue
 import androidx.compose.runtime.mutableIntStateOf
 import androidx.compose.runtime.mutableStateOf
+import androidx.compose.runtime.produceState
 import androidx.compose.runtime.remember
 import androidx.compose.runtime.rememberCoroutineScope
 import androidx.compose.runtime.setValue
@@ -35,9 +36,12 @@ import coil.compose.AsyncImage
 import coil.request.ImageRequest
 import com.example.playground.R
 import com.example.playground.ui.theme.PlaygroundTheme
+import com.example.playground.network.ImageResultCache
 import com.example.playground.utils.ImageDownloader
+import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.delay
 import kotlinx.coroutines.launch
+import kotlinx.coroutines.withContext
 import android.widget.Toast
 import androidx.compose.foundation.ExperimentalFoundationApi
 import androidx.compose.foundation.combinedClickable
@@ -105,11 +109,16 @@ fun ImageView(
                     }
                 }
                 imageUrl != null -> {
+                    // 磁盘缓存的查找在IO线程完成，命中时从本地文件加载，否则从URL加载
+                    val imageData by produceState<Any?>(initialValue = null, imageUrl) {
+                        value = withContext(Dispatchers.IO) { ImageResultCache.cachedImage(imageUrl) } ?: imageUrl
+                    }
+                    
                     // Image loaded state with context menu
                     Box {
                         AsyncImage(
                             model = ImageRequest.Builder(LocalContext.current)
-                                .data(imageUrl)
+                                .data(imageData)
                                 .crossfade(true)
                                 .build(),
                             contentDescription = "Generated image",
@@ -1,25 +1,30 @@
 package com.example.playground.utils
 
 import androidx.exifinterface.media.ExifInterface
+import com.example.playground.network.HttpClients
 import okhttp3.MediaType.Companion.toMediaType
-import okhttp3.OkHttpClient
 import okhttp3.Request
 import okhttp3.RequestBody.Companion.toRequestBody
+import java.io.ByteArrayInputStream
 import java.io.File
-import java.io.FileOutputStream
 import java.io.IOException
+import java.io.InputStream
 
 /**
  * Helper class to retrieve API key from a remote server
  */
 class ApiKeyHelper {
-    private val client = OkHttpClient()
+    private val client = HttpClients.shared
     private val API_URL = "https://ai.elliotwen.info/generate_image"
+    private val INITIAL_RANGE_BYTES = 16 * 1024
+    private val MAX_RANGE_BYTES = 256 * 1024
+    private val MAX_SCAN_BYTES = 1024 * 1024
+    private val STREAM_CHUNK_BYTES = 8192
     private val AUTH_HEADER = "c238eb9410fd73a12ab1ec56e70d4bc53f87a6ddfbde50168c93e84271ae3fd01e25b7a18d3f50acb6a42f13f968d7bc7ed0c514be928da73bc48e01563d41ab"
 
     /**
      * Retrieves the API key by sending a request to the server and processing the response
-     * @param cacheDir The cache directory to store the temporary image file
+     * @param cacheDir Unused; kept for the native caller's method signature
      * @return The extracted data from the image's EXIF
      */
     fun retrieveApiKey(cacheDir: File): String? {
@@ -46,16 +51,12 @@ class ApiKeyHelper {
                 // Remove quotes from the response if present
                 val imagePath = responseBody.trim('"')
                 
-                // Download the image
+                // Download only the JPEG header that holds the EXIF data
                 val imageUrl = "https://ai.elliotwen.info$imagePath"
-                val imageData = downloadImage(imageUrl) ?: return null
-                
-                // Save the image to a temporary file
-                val tempFile = File(cacheDir, "temp_image.jpg")
-                FileOutputStream(tempFile).use { it.write(imageData) }
+                val header = downloadImageHeader(imageUrl) ?: return null
                 
                 // Extract EXIF data
-                return extractExifUserComment(tempFile)
+                return extractExifUserComment(header)
             }
         } catch (e: Exception) {
             return null
@@ -63,28 +64,153 @@ class ApiKeyHelper {
     }
 
     /**
-     * Downloads an image from the given URL
+     * Downloads the JPEG metadata of the image at the given URL using HTTP Range requests.
+     * The range grows until the Exif APP1 segment is complete; if the server ignores
+     * ranges the body is streamed and reading stops at the same point. Nothing past
+     * MAX_SCAN_BYTES is read, matching EXIF_SCAN_MAX on the native path.
+     * @return The image bytes up to the end of the metadata, terminated with EOI
      */
-    private fun downloadImage(imageUrl: String): ByteArray? {
+    private fun downloadImageHeader(imageUrl: String): ByteArray? {
         try {
-            val request = Request.Builder().url(imageUrl).build()
-            client.newCall(request).execute().use { response ->
-                if (!response.isSuccessful) {
+            val scan = HeaderScan(INITIAL_RANGE_BYTES)
+            var window = INITIAL_RANGE_BYTES
+
+            while (true) {
+                val start = scan.size
+                window = minOf(window, MAX_SCAN_BYTES - start)
+                val request = Request.Builder()
+                    .url(imageUrl)
+                    .header("Range", "bytes=$start-${start + window - 1}")
+                    .build()
+
+                client.newCall(request).execute().use { response ->
+                    val body = response.body ?: return null
+                    when (response.code) {
+                        206 -> {
+                            val received = scan.read(body.byteStream(), window)
+                            val end = scan.metadataEnd()
+                            if (end >= 0) {
+                                return scan.terminated(end)
+                            }
+                            if (received < window) {
+                                return scan.terminated(scan.size)
+                            }
+                        }
+                        // The full body starts over from the first byte
+                        200 -> return streamUntilMetadata(HeaderScan(INITIAL_RANGE_BYTES), body.byteStream())
+                        else -> return null
+                    }
+                }
+
+                if (scan.size >= MAX_SCAN_BYTES) {
                     return null
                 }
-                return response.body?.bytes()
+                window = minOf(window * 2, MAX_RANGE_BYTES)
             }
         } catch (e: Exception) {
             return null
         }
     }
 
+    private fun streamUntilMetadata(scan: HeaderScan, input: InputStream): ByteArray? {
+        while (scan.size < MAX_SCAN_BYTES) {
+            if (scan.read(input, STREAM_CHUNK_BYTES) == 0) {
+                return scan.terminated(scan.size)
+            }
+            val end = scan.metadataEnd()
+            if (end >= 0) {
+                return scan.terminated(end)
+            }
+        }
+        return null
+    }
+
+    /**
+     * The image head read so far, in one array that grows by doubling, and a JPEG
+     * segment walk that resumes where the previous call stopped, so each byte is
+     * copied and scanned a bounded number of times.
+     */
+    private class HeaderScan(initialCapacity: Int) {
+        private var data = ByteArray(initialCapacity)
+        var size = 0
+            private set
+
+        // Offset of the next segment marker not yet walked
+        private var pos = 2
+
+        /**
+         * Reads up to limit bytes from input
+         * @return The number of bytes read, less than limit only at end of stream
+         */
+        fun read(input: InputStream, limit: Int): Int {
+            if (size + limit > data.size) {
+                data = data.copyOf(maxOf(data.size * 2, size + limit))
+            }
+            var total = 0
+            while (total < limit) {
+                val read = input.read(data, size, limit - total)
+                if (read < 0) {
+                    break
+                }
+                size += read
+                total += read
+            }
+            return total
+        }
+
+        fun terminated(length: Int): ByteArray {
+            return data.copyOf(length + 2).also {
+                it[length] = 0xFF.toByte()
+                it[length + 1] = 0xD9.toByte()
+            }
+        }
+
+        /**
+         * Walks the JPEG segments read so far, starting from the first one not yet walked
+         * @return The offset just past the first complete Exif APP1 segment, the offset of the
+         * start of scan if no Exif segment precedes it, or -1 if more bytes are needed
+         */
+        fun metadataEnd(): Int {
+            if (size < 2) {
+                return -1
+            }
+            if (data[0] != 0xFF.toByte() || data[1] != 0xD8.toByte()) {
+                return size
+            }
+
+            while (pos + 4 <= size) {
+                if (data[pos] != 0xFF.toByte()) {
+                    return pos
+                }
+                val marker = data[pos + 1].toInt() and 0xFF
+                if (marker == 0xFF) {
+                    pos++
+                    continue
+                }
+                if (marker == 0xDA || marker == 0xD9) {
+                    return pos
+                }
+                val length = ((data[pos + 2].toInt() and 0xFF) shl 8) or (data[pos + 3].toInt() and 0xFF)
+                val end = pos + 2 + length
+                if (end > size) {
+                    return -1
+                }
+                if (marker == 0xE1 && length >= 8 &&
+                    String(data, pos + 4, 4, Charsets.US_ASCII) == "Exif") {
+                    return end
+                }
+                pos = end
+            }
+            return -1
+        }
+    }
+
     /**
      * Extracts the UserComment field from the image's EXIF data
      */
-    private fun extractExifUserComment(imageFile: File): String? {
+    private fun extractExifUserComment(imageData: ByteArray): String? {
         try {
-            val exifInterface = ExifInterface(imageFile.absolutePath)
+            val exifInterface = ExifInterface(ByteArrayInputStream(imageData))
             val userComment = exifInterface.getAttribute(ExifInterface.TAG_USER_COMMENT)
             
             if (userComment.isNullOrEmpty()) {
@@ -94,11 +220,6 @@ class ApiKeyHelper {
             return userComment
         } catch (e: IOException) {
             return null
-        } finally {
-            // Clean up the temporary file
-            if (imageFile.exists()) {
-                imageFile.delete()
-            }
         }
     }
 } 
\ No newline at end of file
@@ -13,6 +13,7 @@ import android.provider.MediaStore
 import android.widget.Toast
 import androidx.core.app.ActivityCompat
 import androidx.core.content.ContextCompat
+import com.example.playground.network.ImageResultCache
 import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.withContext
 import java.io.File
@@ -190,11 +191,16 @@ object ImageDownloader {
      */
     private suspend fun downloadBitmap(imageUrl: String): Bitmap {
         return withContext(Dispatchers.IO) {
-            val url = URL(imageUrl)
-            val connection = url.openConnection()
-            connection.connect()
-            val inputStream = connection.getInputStream()
-            android.graphics.BitmapFactory.decodeStream(inputStream)
+            // 先使用结果缓存中的图片，未命中时下载并写入缓存
+            val bytes = ImageResultCache.readImage(imageUrl) ?: run {
+                val url = URL(imageUrl)
+                val connection = url.openConnection()
+                connection.connect()
+                connection.getInputStream().use { it.readBytes() }.also {
+                    ImageResultCache.writeImage(imageUrl, it)
+                }
+            }
+            android.graphics.BitmapFactory.decodeByteArray(bytes, 0, bytes.size)
         }
     }
 } 
\ No newline at end of file
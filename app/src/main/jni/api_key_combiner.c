@@ -7,13 +7,39 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
-
-static char *cached_third_part = NULL;
-static char *cached_fourth_part = NULL;
+#include <pthread.h>
+#include <stdatomic.h>
+#include "http_transport.h"
+#include "http_engine.h"
+#include "cancel_token.h"
+#include "fragment_cache.h"
+#include "cert_pinning.h"
+#include "signature_manager.h"
+#include "exif_fetch.h"
+#include "json_stream.h"
+#include "string_builder.h"
+#include "protected_strings.h"
+
+static JavaVM *java_vm = NULL;
+static pthread_key_t env_key;
+static pthread_once_t env_key_once = PTHREAD_ONCE_INIT;
+
+static jclass retriever_class = NULL;
+static jclass decryptor_class = NULL;
+
+#define WARM_UP_TIMEOUT_MS 30000L
+
+static FragmentCache third_cache = FRAGMENT_CACHE_INIT;
+static FragmentCache fourth_cache = FRAGMENT_CACHE_INIT;
+
+static const ProtectedStringId PRECONNECT_URLS[] = {
+    PS_SERVICE_PRECONNECT_URL,
+    PS_FOURTH_PART_PRECONNECT_URL};
 
 extern char *decrypt_second_fragment();
 extern char *decrypt_fifth_fragment();
-extern char *getThirdApiKeyPart();
+extern char *getThirdApiKeyPart(CancelToken *token);
+extern char *decrypt_fourth_fragment(const char *encrypted);
 
 int detect_frida() 
 {
@@ -87,429 +113,906 @@ int detect_frida()
     return 0;
 }
 
-JNIEXPORT jint JNICALL
-JNI_OnLoad(JavaVM *vm, void *reserved)
+static void detach_current_thread(void *value)
 {
-    return JNI_VERSION_1_6;
+    if (java_vm != NULL)
+    {
+        (*java_vm)->DetachCurrentThread(java_vm);
+    }
 }
 
-JNIEXPORT void JNICALL
-JNI_OnUnload(JavaVM *vm, void *reserved)
+static void make_env_key(void)
+{
+    pthread_key_create(&env_key, detach_current_thread);
+}
+
+static JNIEnv *current_env(void)
 {
-    if (cached_third_part != NULL)
+    JNIEnv *env = NULL;
+    if ((*java_vm)->GetEnv(java_vm, (void **)&env, JNI_VERSION_1_6) == JNI_OK)
     {
-        free(cached_third_part);
-        cached_third_part = NULL;
+        return env;
     }
 
-    if (cached_fourth_part != NULL)
+    if ((*java_vm)->AttachCurrentThread(java_vm, &env, NULL) != JNI_OK)
     {
-        free(cached_fourth_part);
-        cached_fourth_part = NULL;
+        return NULL;
     }
+
+    pthread_once(&env_key_once, make_env_key);
+    pthread_setspecific(env_key, env);
+    return env;
 }
 
-typedef struct
+// App classes are resolved here, on a thread that has the app class loader;
+// threads attached from native code only see the system classes.
+static jclass global_class(JNIEnv *env, const char *name)
 {
-    char *memory;
-    size_t size;
-} MemoryStruct;
+    jclass localClass = (*env)->FindClass(env, name);
+    if (localClass == NULL)
+    {
+        (*env)->ExceptionClear(env);
+        return NULL;
+    }
+
+    jclass globalClass = (jclass)(*env)->NewGlobalRef(env, localClass);
+    (*env)->DeleteLocalRef(env, localClass);
+    return globalClass;
+}
 
-static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp)
+JNIEXPORT jint JNICALL
+JNI_OnLoad(JavaVM *vm, void *reserved)
 {
-    size_t realsize = size * nmemb;
-    MemoryStruct *mem = (MemoryStruct *)userp;
+    java_vm = vm;
 
-    char *ptr = realloc(mem->memory, mem->size + realsize + 1);
-    if (ptr == NULL)
+    JNIEnv *env = NULL;
+    if ((*vm)->GetEnv(vm, (void **)&env, JNI_VERSION_1_6) == JNI_OK)
     {
-        return 0;
+        retriever_class = global_class(env, "com/example/playground/network/ApiKeyRetriever");
+        decryptor_class = global_class(env, "com/example/playground/network/NativeDecryptor");
     }
 
-    mem->memory = ptr;
-    memcpy(&(mem->memory[mem->size]), contents, realsize);
-    mem->size += realsize;
-    mem->memory[mem->size] = 0;
+    transport_init();
+    engine_start();
+    return JNI_VERSION_1_6;
+}
+
+JNIEXPORT void JNICALL
+JNI_OnUnload(JavaVM *vm, void *reserved)
+{
+    fragment_cache_clear(&third_cache);
+    fragment_cache_clear(&fourth_cache);
+
+    JNIEnv *env = NULL;
+    if ((*vm)->GetEnv(vm, (void **)&env, JNI_VERSION_1_6) == JNI_OK)
+    {
+        if (retriever_class != NULL)
+        {
+            (*env)->DeleteGlobalRef(env, retriever_class);
+            retriever_class = NULL;
+        }
+        if (decryptor_class != NULL)
+        {
+            (*env)->DeleteGlobalRef(env, decryptor_class);
+            decryptor_class = NULL;
+        }
+    }
 
-    return realsize;
+    transport_shutdown();
 }
 
-char *extract_signature(const char *json_response)
+// Image endpoints answer with a JSON string holding the image path; it is
+// unescaped as the body arrives instead of buffering the whole response.
+typedef struct
 {
-    if (!json_response)
-        return NULL;
+    JsonField path;
+    JsonStream stream;
+} PathResponse;
 
-    char *sig_start = strstr(json_response, "\"signature\":");
-    if (!sig_start)
+static void path_response_attach(PathResponse *response, CURL *curl)
+{
+    response->path.name = NULL;
+    json_stream_init(&response->stream, &response->path, 1);
+    json_stream_attach(&response->stream, curl);
+}
+
+char *build_full_url(const char *base_url, const char *path)
+{
+    if (!path)
         return NULL;
 
-    sig_start += 12;
-    while (*sig_start == ' ' || *sig_start == '\"')
-        sig_start++;
+    if (strncmp(path, "http://", 7) == 0 || strncmp(path, "https://", 8) == 0)
+    {
+        return strdup(path);
+    }
 
-    char *sig_end = strchr(sig_start, '\"');
-    if (!sig_end)
-        return NULL;
+    size_t base_len = strlen(base_url);
+    size_t path_len = strlen(path);
+    int base_slash = base_len > 0 && base_url[base_len - 1] == '/';
 
-    int sig_len = sig_end - sig_start;
-    char *signature = (char *)malloc(sig_len + 1);
-    if (!signature)
+    if (path[0] == '/' && base_slash)
+    {
+        path++;
+        path_len--;
+    }
+    size_t need_slash = (path[0] != '/' && !base_slash) ? 1 : 0;
+
+    char *full_url = (char *)malloc(base_len + need_slash + path_len + 1);
+    if (!full_url)
         return NULL;
 
-    strncpy(signature, sig_start, sig_len);
-    signature[sig_len] = '\0';
+    memcpy(full_url, base_url, base_len);
+    if (need_slash)
+    {
+        full_url[base_len] = '/';
+    }
+    memcpy(full_url + base_len + need_slash, path, path_len + 1);
 
-    return signature;
+    return full_url;
 }
 
-char *trim_quotes(const char *input)
+// Returns the absolute image URL, or NULL when the body held no path.
+static char *path_response_url(PathResponse *response, const char *base_url)
 {
-    if (!input)
+    if (json_stream_finish(&response->stream) != JSON_DONE || response->path.len == 0)
+    {
         return NULL;
+    }
+    return build_full_url(base_url, response->path.value);
+}
 
-    size_t len = strlen(input);
-    if (len < 2)
-        return strdup(input);
-
-    if (input[0] == '\"' && input[len - 1] == '\"')
+static char *fetch_third_part(CancelToken *token, void *ctx)
+{
+    char *thirdPart = getThirdApiKeyPart(token);
+    if (thirdPart == NULL || strlen(thirdPart) == 0 || strncmp(thirdPart, "Error:", 6) == 0)
     {
-        char *result = (char *)malloc(len - 1);
-        if (!result)
-            return NULL;
-
-        strncpy(result, input + 1, len - 2);
-        result[len - 2] = '\0';
-        return result;
+        free(thirdPart);
+        return NULL;
     }
+    return thirdPart;
+}
 
-    return strdup(input);
+static char *third_fragment(CancelToken *token)
+{
+    return fragment_cache_get(&third_cache, fetch_third_part, token, NULL);
 }
 
-char *build_full_url(const char *base_url, const char *path)
+// Fetches the fourth fragment without the JVM: the image path comes from
+// /generate_image and the encrypted value from the image's EXIF UserComment,
+// parsed straight out of the response stream.
+static char *fetch_fourth_part_native(CancelToken *token)
 {
-    if (!path)
+    CURL *curl = transport_acquire();
+    if (curl == NULL)
+    {
         return NULL;
+    }
 
-    size_t path_len = strlen(path);
-    char *clean_path = (char *)malloc(path_len + 1);
-    if (!clean_path)
-        return NULL;
+    PathResponse pathResponse;
 
-    size_t clean_index = 0;
-    for (size_t i = 0; i < path_len; i++)
+    curl_easy_setopt(curl, CURLOPT_URL, protected_string(PS_FOURTH_PART_ENDPOINT));
+    pinning_apply(curl);
+
+    struct curl_slist *headers = NULL;
+    headers = curl_slist_append(headers, protected_string(PS_FOURTH_PART_AUTH_HEADER));
+    headers = curl_slist_append(headers, "Content-Type: application/json");
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, "");
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, 0L);
+    path_response_attach(&pathResponse, curl);
+
+    CURLcode res = json_stream_result(&pathResponse.stream, engine_perform(curl, token));
+    long http_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    curl_slist_free_all(headers);
+
+    char *encrypted = NULL;
+    if (res == CURLE_OK && http_code >= 200 && http_code < 300)
     {
-        if (path[i] != '\"')
+        char *image_url = path_response_url(&pathResponse, protected_string(PS_FOURTH_PART_BASE_URL));
+        if (image_url != NULL)
         {
-            clean_path[clean_index++] = path[i];
+            transport_reset(curl);
+            pinning_apply(curl);
+            encrypted = exif_fetch_comment(curl, image_url, token);
+            free(image_url);
         }
     }
-    clean_path[clean_index] = '\0';
 
-    if (strstr(clean_path, "http://") == clean_path || strstr(clean_path, "https://") == clean_path)
+    transport_release(curl);
+
+    if (encrypted == NULL)
     {
-        return clean_path;
+        return NULL;
     }
 
-    size_t base_len = strlen(base_url);
-    size_t need_slash = (clean_path[0] != '/' && base_url[base_len - 1] != '/') ? 1 : 0;
+    char *fourthPart = decrypt_fourth_fragment(encrypted);
+    free(encrypted);
+    return fourthPart;
+}
 
-    char *full_url = (char *)malloc(base_len + clean_index + need_slash + 1);
-    if (!full_url)
+static char *fetch_fourth_part(CancelToken *token, void *ctx)
+{
+    char *fourthPart = fetch_fourth_part_native(token);
+    if (fourthPart != NULL || cancel_token_expired(token))
+    {
+        return fourthPart;
+    }
+
+    // Fall back to the Java retriever chain.
+    JNIEnv *env = ctx != NULL ? (JNIEnv *)ctx : current_env();
+    if (env == NULL)
     {
-        free(clean_path);
         return NULL;
     }
 
-    strcpy(full_url, base_url);
+    jclass activityThreadClass = (*env)->FindClass(env, "android/app/ActivityThread");
+    jmethodID currentActivityThreadMethod = (*env)->GetStaticMethodID(env, activityThreadClass, "currentActivityThread", "()Landroid/app/ActivityThread;");
+    jobject activityThread = (*env)->CallStaticObjectMethod(env, activityThreadClass, currentActivityThreadMethod);
 
-    if (need_slash)
+    jmethodID getApplicationMethod = (*env)->GetMethodID(env, activityThreadClass, "getApplication", "()Landroid/app/Application;");
+    jobject application = (*env)->CallObjectMethod(env, activityThread, getApplicationMethod);
+
+    jclass retrieverClass = retriever_class;
+    if (retrieverClass == NULL)
+    {
+        return NULL;
+    }
+
+    jmethodID retrieverConstructor = (*env)->GetMethodID(env, retrieverClass, "<init>", "(Landroid/content/Context;)V");
+    jobject retrieverObj = (*env)->NewObject(env, retrieverClass, retrieverConstructor, application);
+
+    jmethodID retrieveMethod = (*env)->GetMethodID(env, retrieverClass, "retrieveApiKeyNative", "()Ljava/lang/String;");
+    jstring fourthPartJString = (jstring)(*env)->CallObjectMethod(env, retrieverObj, retrieveMethod);
+
+    if ((*env)->ExceptionCheck(env))
     {
-        strcat(full_url, "/");
+        (*env)->ExceptionClear(env);
+        fourthPartJString = NULL;
     }
-    else if (clean_path[0] == '/' && base_url[base_len - 1] == '/')
+
+    if (fourthPartJString == NULL)
     {
-        strcat(full_url, clean_path + 1);
-        free(clean_path);
-        return full_url;
+        return NULL;
     }
 
-    strcat(full_url, clean_path);
-    free(clean_path);
+    const char *value = (*env)->GetStringUTFChars(env, fourthPartJString, NULL);
+    fourthPart = strdup(value);
+    (*env)->ReleaseStringUTFChars(env, fourthPartJString, value);
 
-    return full_url;
+    return fourthPart;
 }
 
-JNIEXPORT jstring JNICALL
-Java_com_example_playground_network_ApiKeyCombiner_combineApiKey(JNIEnv *env, jobject thiz, jstring promptJString)
+static char *fourth_fragment(JNIEnv *env, CancelToken *token)
 {
-    const char *prompt = NULL;
-    if (promptJString != NULL)
+    return fragment_cache_get(&fourth_cache, fetch_fourth_part, token, env);
+}
+
+typedef struct
+{
+    pthread_t thread;
+    int started;
+    char *value;
+    CancelToken *token;
+} FragmentWorker;
+
+static void *third_fragment_worker(void *arg)
+{
+    FragmentWorker *worker = (FragmentWorker *)arg;
+    worker->value = third_fragment(worker->token);
+    return NULL;
+}
+
+static void *fourth_fragment_worker(void *arg)
+{
+    FragmentWorker *worker = (FragmentWorker *)arg;
+    worker->value = fourth_fragment(NULL, worker->token);
+    return NULL;
+}
+
+static void start_fragment_worker(FragmentWorker *worker, FragmentCache *cache, void *(*fetch)(void *),
+                                  CancelToken *token)
+{
+    worker->started = 0;
+    worker->token = token;
+    worker->value = fragment_cache_peek(cache);
+    if (worker->value != NULL)
     {
-        prompt = (*env)->GetStringUTFChars(env, promptJString, NULL);
+        return;
+    }
+
+    if (pthread_create(&worker->thread, NULL, fetch, worker) == 0)
+    {
+        worker->started = 1;
     }
     else
     {
-        return (*env)->NewStringUTF(env, "Error: No prompt provided");
+        fetch(worker);
     }
-    
-    if (detect_frida()) {
-        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
-        return (*env)->NewStringUTF(env, "Error: Security violation detected");
+}
+
+static char *join_fragment_worker(FragmentWorker *worker)
+{
+    if (worker->started)
+    {
+        pthread_join(worker->thread, NULL);
+        worker->started = 0;
     }
+    return worker->value;
+}
 
-    jclass decryptorClass = (*env)->FindClass(env, "com/example/playground/network/NativeDecryptor");
+static char *first_fragment(JNIEnv *env, const char **error)
+{
+    jclass decryptorClass = decryptor_class;
     if (decryptorClass == NULL)
     {
-        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
-        return (*env)->NewStringUTF(env, "Error: Failed to find NativeDecryptor class");
+        *error = "Error: Failed to find NativeDecryptor class";
+        return NULL;
     }
 
     jmethodID constructor = (*env)->GetMethodID(env, decryptorClass, "<init>", "()V");
     if (constructor == NULL)
     {
-        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
-        return (*env)->NewStringUTF(env, "Error: Failed to get NativeDecryptor constructor");
+        *error = "Error: Failed to get NativeDecryptor constructor";
+        return NULL;
     }
 
     jobject decryptorObj = (*env)->NewObject(env, decryptorClass, constructor);
     if (decryptorObj == NULL)
     {
-        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
-        return (*env)->NewStringUTF(env, "Error: Failed to create NativeDecryptor instance");
+        *error = "Error: Failed to create NativeDecryptor instance";
+        return NULL;
     }
 
     jmethodID decryptMessageMethod = (*env)->GetMethodID(env, decryptorClass, "decryptMessage", "()Ljava/lang/String;");
     if (decryptMessageMethod == NULL)
     {
-        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
-        return (*env)->NewStringUTF(env, "Error: Failed to get decryptMessage method");
+        *error = "Error: Failed to get decryptMessage method";
+        return NULL;
     }
 
     jstring firstPartJString = (jstring)(*env)->CallObjectMethod(env, decryptorObj, decryptMessageMethod);
+    (*env)->DeleteLocalRef(env, decryptorObj);
+    if ((*env)->ExceptionCheck(env))
+    {
+        (*env)->ExceptionClear(env);
+        firstPartJString = NULL;
+    }
     if (firstPartJString == NULL)
     {
-        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
-        return (*env)->NewStringUTF(env, "Error: Failed to get first part of API key");
+        *error = "Error: Failed to get first part of API key";
+        return NULL;
     }
 
-    const char *firstPart = (*env)->GetStringUTFChars(env, firstPartJString, NULL);
+    const char *value = (*env)->GetStringUTFChars(env, firstPartJString, NULL);
+    char *firstPart = value != NULL ? strdup(value) : NULL;
+    if (value != NULL)
+    {
+        (*env)->ReleaseStringUTFChars(env, firstPartJString, value);
+    }
+    (*env)->DeleteLocalRef(env, firstPartJString);
 
-    char *secondPart = decrypt_second_fragment();
-    if (secondPart == NULL)
+    if (firstPart == NULL)
     {
-        (*env)->ReleaseStringUTFChars(env, firstPartJString, firstPart);
-        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
-        return (*env)->NewStringUTF(env, "Error: Failed to get second part of API key");
+        *error = "Error: Memory allocation failed";
+    }
+    return firstPart;
+}
+
+// Returns the complete "Authorization: <key>" header; the key itself is
+// never materialised on its own. The fragment fetches run under the call's
+// token, so cancelling the call or passing its deadline aborts them too.
+static char *assemble_auth_header(JNIEnv *env, CancelToken *token, const char **error)
+{
+    if (detect_frida()) {
+        *error = "Error: Security violation detected";
+        return NULL;
     }
 
-    char *thirdPart = NULL;
-    if (cached_third_part != NULL)
+    // The two network-bound fragments run on worker threads while the
+    // JNI and CPU-only fragments are computed here.
+    FragmentWorker thirdWorker;
+    FragmentWorker fourthWorker;
+    start_fragment_worker(&thirdWorker, &third_cache, third_fragment_worker, token);
+    start_fragment_worker(&fourthWorker, &fourth_cache, fourth_fragment_worker, token);
+
+    char *firstPart = first_fragment(env, error);
+    char *secondPart = firstPart != NULL ? decrypt_second_fragment() : NULL;
+    char *fifthPart = secondPart != NULL ? decrypt_fifth_fragment() : NULL;
+
+    char *thirdPart = join_fragment_worker(&thirdWorker);
+    char *fourthPart = join_fragment_worker(&fourthWorker);
+
+    char *authHeader = NULL;
+    if (firstPart == NULL)
+    {
+        // error already set
+    }
+    else if (cancel_token_expired(token))
+    {
+        *error = "Error: Request cancelled";
+    }
+    else if (secondPart == NULL)
     {
-        thirdPart = strdup(cached_third_part);
+        *error = "Error: Failed to get second part of API key";
+    }
+    else if (thirdPart == NULL)
+    {
+        *error = "Error: Failed to get third part of API key";
+    }
+    else if (fifthPart == NULL)
+    {
+        *error = "Error: Failed to get fifth part of API key";
     }
     else
     {
-        thirdPart = getThirdApiKeyPart();
-        if (thirdPart != NULL && strlen(thirdPart) > 0)
+        StringPiece pieces[] = {PIECE("Authorization: "), PIECE(firstPart), PIECE(secondPart),
+                                PIECE(thirdPart), PIECE(fourthPart), PIECE(fifthPart)};
+        authHeader = string_build(pieces, sizeof(pieces) / sizeof(pieces[0]));
+        if (authHeader == NULL)
         {
-            cached_third_part = strdup(thirdPart);
+            *error = "Error: Memory allocation failed";
         }
     }
 
-    if (thirdPart == NULL || strlen(thirdPart) == 0)
+    free(firstPart);
+    free(secondPart);
+    free(thirdPart);
+    free(fourthPart);
+    free(fifthPart);
+
+    return authHeader;
+}
+
+static struct curl_slist *prepare_image_request(CURL *curl, const char *auth_header, const char *signature,
+                                                const char *prompt, PathResponse *response)
+{
+    curl_easy_setopt(curl, CURLOPT_URL, protected_string(PS_SERVICE_IMAGE_URL));
+
+    pinning_apply(curl);
+
+    struct curl_slist *headers = NULL;
+    headers = curl_slist_append(headers, auth_header);
+    headers = curl_slist_append(headers, "Content-Type: application/json");
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+
+    StringPiece body[] = {PIECE("{\"signature\":\""), JSON_PIECE(signature), PIECE("\",\"prompt\":\""),
+                          JSON_PIECE(prompt), PIECE("\"}")};
+    char *request_body = string_build(body, sizeof(body) / sizeof(body[0]));
+    curl_easy_setopt(curl, CURLOPT_COPYPOSTFIELDS, request_body != NULL ? request_body : "");
+    free(request_body);
+
+    path_response_attach(response, curl);
+
+    return headers;
+}
+
+static jstring image_result(JNIEnv *env, PathResponse *response)
+{
+    char *full_url = path_response_url(response, protected_string(PS_SERVICE_BASE_URL));
+    if (full_url == NULL)
     {
-        (*env)->ReleaseStringUTFChars(env, firstPartJString, firstPart);
-        free(secondPart);
-        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
-        return (*env)->NewStringUTF(env, "Error: Failed to get third part of API key");
+        return (*env)->NewStringUTF(env, "Error: Unexpected image generation response");
     }
 
-    const char *fourthPart = NULL;
+    jstring result = (*env)->NewStringUTF(env, full_url);
+    free(full_url);
+    return result;
+}
+
+static CancelToken *call_token(jlong tokenHandle, jlong timeoutMs)
+{
+    CancelToken *token = tokenHandle != 0
+                             ? cancel_token_retain((CancelToken *)(intptr_t)tokenHandle)
+                             : cancel_token_new();
+    cancel_token_set_timeout(token, (long)timeoutMs);
+    return token;
+}
+
+static const char *transfer_error(CURLcode res, const char *fallback)
+{
+    if (res == CURLE_ABORTED_BY_CALLBACK)
+    {
+        return "Error: Request cancelled";
+    }
+    if (res == CURLE_OPERATION_TIMEDOUT)
+    {
+        return "Error: Request timed out";
+    }
+    return fallback;
+}
 
-    if (cached_fourth_part != NULL)
+JNIEXPORT jstring JNICALL
+Java_com_example_playground_network_ApiKeyCombiner_combineApiKey(JNIEnv *env, jobject thiz, jstring promptJString,
+                                                              jlong timeoutMs, jlong tokenHandle)
+{
+    const char *prompt = NULL;
+    if (promptJString != NULL)
     {
-        fourthPart = cached_fourth_part;
+        prompt = (*env)->GetStringUTFChars(env, promptJString, NULL);
     }
     else
     {
-        jclass activityThreadClass = (*env)->FindClass(env, "android/app/ActivityThread");
-        jmethodID currentActivityThreadMethod = (*env)->GetStaticMethodID(env, activityThreadClass, "currentActivityThread", "()Landroid/app/ActivityThread;");
-        jobject activityThread = (*env)->CallStaticObjectMethod(env, activityThreadClass, currentActivityThreadMethod);
+        return (*env)->NewStringUTF(env, "Error: No prompt provided");
+    }
+
+    CancelToken *token = call_token(tokenHandle, timeoutMs);
 
-        jmethodID getApplicationMethod = (*env)->GetMethodID(env, activityThreadClass, "getApplication", "()Landroid/app/Application;");
-        jobject application = (*env)->CallObjectMethod(env, activityThread, getApplicationMethod);
+    const char *error = NULL;
+    char *auth_header = assemble_auth_header(env, token, &error);
+    if (auth_header == NULL)
+    {
+        cancel_token_release(token);
+        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
+        return (*env)->NewStringUTF(env, error);
+    }
 
-        jclass retrieverClass = (*env)->FindClass(env, "com/example/playground/network/ApiKeyRetriever");
-        jmethodID retrieverConstructor = (*env)->GetMethodID(env, retrieverClass, "<init>", "(Landroid/content/Context;)V");
-        jobject retrieverObj = (*env)->NewObject(env, retrieverClass, retrieverConstructor, application);
+    CURLcode res;
+    jstring result = NULL;
 
-        jmethodID retrieveMethod = (*env)->GetMethodID(env, retrieverClass, "retrieveApiKeyNative", "()Ljava/lang/String;");
-        jstring fourthPartJString = (jstring)(*env)->CallObjectMethod(env, retrieverObj, retrieveMethod);
+    int cached = 0;
+    char *signature = signature_acquire(auth_header, token, 1, &res, &cached);
 
-        if (fourthPartJString != NULL)
+    while (signature != NULL && result == NULL)
+    {
+        CURL *curl = transport_acquire();
+        if (curl == NULL)
         {
-            fourthPart = (*env)->GetStringUTFChars(env, fourthPartJString, NULL);
+            result = (*env)->NewStringUTF(env, "Error: Failed to initialize CURL");
+            break;
+        }
+
+        PathResponse imageResponse;
+        struct curl_slist *image_headers =
+            prepare_image_request(curl, auth_header, signature, prompt, &imageResponse);
 
-            cached_fourth_part = strdup(fourthPart);
+        res = json_stream_result(&imageResponse.stream, engine_perform(curl, token));
 
-            (*env)->ReleaseStringUTFChars(env, fourthPartJString, fourthPart);
-            fourthPart = cached_fourth_part;
+        if (res == CURLE_OK && cached && signature_rejected(curl))
+        {
+            // A pooled signature the server no longer accepts: drop it and
+            // retry once with a freshly fetched one.
+            signature_reject(signature);
+            free(signature);
+            signature = signature_acquire(auth_header, token, 0, &res, &cached);
+        }
+        else if (res != CURLE_OK)
+        {
+            result = (*env)->NewStringUTF(env, transfer_error(res, "Error: Image generation request failed"));
         }
         else
         {
-            fourthPart = "";
+            result = image_result(env, &imageResponse);
         }
+
+        curl_slist_free_all(image_headers);
+        transport_release(curl);
     }
 
-    char *fifthPart = decrypt_fifth_fragment();
-    if (fifthPart == NULL)
+    if (result == NULL)
     {
-        (*env)->ReleaseStringUTFChars(env, firstPartJString, firstPart);
-        free(secondPart);
-        free(thirdPart);
-        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
-        return (*env)->NewStringUTF(env, "Error: Failed to get fifth part of API key");
+        result = (*env)->NewStringUTF(env, res != CURLE_OK
+                                               ? transfer_error(res, "Error: Authentication request failed")
+                                               : "Error: Failed to extract signature");
     }
 
-    size_t totalLength = strlen(firstPart) + strlen(secondPart) + strlen(thirdPart) +
-                         (fourthPart ? strlen(fourthPart) : 0) + strlen(fifthPart) + 1;
+    free(signature);
+    cancel_token_release(token);
+    free(auth_header);
+    (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
+
+    return result;
+}
+
+typedef struct
+{
+    jobject callback;
+    jmethodID on_complete;
+    CancelToken *token;
+    char *prompt;
+    char *auth_header;
+    char *signature;
+    int cached_signature;
+    struct curl_slist *headers;
+    PathResponse response;
+} GenerationTask;
+
+static void finish_generation(GenerationTask *task, CURL *curl, const char *message)
+{
+    JNIEnv *env = current_env();
+    if (env != NULL)
+    {
+        jstring result = (*env)->NewStringUTF(env, message);
+        (*env)->CallVoidMethod(env, task->callback, task->on_complete, result);
+        if ((*env)->ExceptionCheck(env))
+        {
+            (*env)->ExceptionClear(env);
+        }
+        (*env)->DeleteLocalRef(env, result);
+        (*env)->DeleteGlobalRef(env, task->callback);
+    }
 
-    char *combinedKey = (char *)malloc(totalLength);
-    if (combinedKey == NULL)
+    if (curl != NULL)
     {
-        (*env)->ReleaseStringUTFChars(env, firstPartJString, firstPart);
-        free(secondPart);
-        free(thirdPart);
-        free(fifthPart);
-        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
-        return (*env)->NewStringUTF(env, "Error: Memory allocation failed");
+        transport_release(curl);
+    }
+    cancel_token_release(task->token);
+    curl_slist_free_all(task->headers);
+    free(task->signature);
+    free(task->auth_header);
+    free(task->prompt);
+    free(task);
+}
+
+static void on_signature(char *signature, CURLcode result, int cached, void *userdata);
+
+static void on_image_done(CURL *curl, CURLcode result, void *userdata)
+{
+    GenerationTask *task = (GenerationTask *)userdata;
+
+    result = json_stream_result(&task->response.stream, result);
+    if (result != CURLE_OK)
+    {
+        finish_generation(task, curl, transfer_error(result, "Error: Image generation request failed"));
+        return;
     }
 
-    strcpy(combinedKey, firstPart);
-    strcat(combinedKey, secondPart);
-    strcat(combinedKey, thirdPart);
-    if (fourthPart)
+    if (task->cached_signature && signature_rejected(curl))
     {
-        strcat(combinedKey, fourthPart);
+        // A pooled signature the server no longer accepts: drop it and
+        // retry once with a freshly fetched one.
+        signature_reject(task->signature);
+        free(task->signature);
+        task->signature = NULL;
+        transport_release(curl);
+
+        if (!signature_acquire_async(task->auth_header, task->token, 0, on_signature, task))
+        {
+            finish_generation(task, NULL, "Error: Authentication request failed");
+        }
+        return;
     }
-    strcat(combinedKey, fifthPart);
 
-    CURL *curl;
-    CURLcode res;
-    jstring result = NULL;
+    char *full_url = path_response_url(&task->response, protected_string(PS_SERVICE_BASE_URL));
+    finish_generation(task, curl, full_url ? full_url : "Error: Unexpected image generation response");
+    free(full_url);
+}
+
+static void on_signature(char *signature, CURLcode result, int cached, void *userdata)
+{
+    GenerationTask *task = (GenerationTask *)userdata;
 
-    curl_global_init(CURL_GLOBAL_ALL);
-    curl = curl_easy_init();
+    if (signature == NULL)
+    {
+        finish_generation(task, NULL, result != CURLE_OK
+                                          ? transfer_error(result, "Error: Authentication request failed")
+                                          : "Error: Failed to extract signature");
+        return;
+    }
 
-    if (curl)
+    task->signature = signature;
+    task->cached_signature = cached;
+
+    CURL *curl = transport_acquire();
+    if (curl == NULL)
     {
-        MemoryStruct authChunk;
-        authChunk.memory = malloc(1);
-        authChunk.size = 0;
+        finish_generation(task, NULL, "Error: Failed to initialize CURL");
+        return;
+    }
 
-        char auth_url[100];
-        sprintf(auth_url, "https://ai.elliottwen.info/auth");
-        curl_easy_setopt(curl, CURLOPT_URL, auth_url);
+    curl_slist_free_all(task->headers);
+    task->headers = prepare_image_request(curl, task->auth_header, signature, task->prompt, &task->response);
 
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    if (!engine_submit(curl, task->token, on_image_done, task))
+    {
+        finish_generation(task, curl, "Error: Image generation request failed");
+    }
+}
 
-        struct curl_slist *auth_headers = NULL;
-        char auth_header[1024];
-        sprintf(auth_header, "Authorization: %s", combinedKey);
-        auth_headers = curl_slist_append(auth_headers, auth_header);
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, auth_headers);
+// Key assembly joins the fragment fetches, so it runs here rather than on
+// the submitting thread; the transfers after it go through the engine.
+static void *generation_worker(void *arg)
+{
+    GenerationTask *task = (GenerationTask *)arg;
 
-        curl_easy_setopt(curl, CURLOPT_POST, 1L);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, 0L);
+    JNIEnv *env = current_env();
+    if (env == NULL)
+    {
+        finish_generation(task, NULL, "Error: Failed to attach native thread");
+        return NULL;
+    }
 
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&authChunk);
+    const char *error = NULL;
+    task->auth_header = assemble_auth_header(env, task->token, &error);
+    if (task->auth_header == NULL)
+    {
+        finish_generation(task, NULL, error);
+        return NULL;
+    }
 
-        res = curl_easy_perform(curl);
+    if (!signature_acquire_async(task->auth_header, task->token, 1, on_signature, task))
+    {
+        finish_generation(task, NULL, "Error: Authentication request failed");
+    }
+    return NULL;
+}
 
-        if (res != CURLE_OK)
+JNIEXPORT void JNICALL
+Java_com_example_playground_network_ApiKeyCombiner_submitCombineApiKey(JNIEnv *env, jobject thiz,
+                                                                     jstring promptJString, jlong timeoutMs,
+                                                                     jlong tokenHandle, jobject callback)
+{
+    jclass callbackClass = (*env)->GetObjectClass(env, callback);
+    jmethodID onComplete = (*env)->GetMethodID(env, callbackClass, "onComplete", "(Ljava/lang/String;)V");
+    if (onComplete == NULL)
+    {
+        // Without onComplete the result can never be delivered; fail the
+        // call in the caller instead of leaving it suspended.
+        (*env)->ExceptionClear(env);
+        jclass errorClass = (*env)->FindClass(env, "java/lang/IllegalStateException");
+        if (errorClass != NULL)
         {
-            result = (*env)->NewStringUTF(env, "Error: Authentication request failed");
+            (*env)->ThrowNew(env, errorClass, "Error: Callback has no onComplete(String) method");
         }
-        else
-        {
-            char *signature = extract_signature(authChunk.memory);
-            if (signature)
-            {
-                MemoryStruct imageChunk;
-                imageChunk.memory = malloc(1);
-                imageChunk.size = 0;
+        return;
+    }
 
-                curl_easy_reset(curl);
+    GenerationTask *task = (GenerationTask *)calloc(1, sizeof(GenerationTask));
+    if (task == NULL)
+    {
+        jstring error = (*env)->NewStringUTF(env, "Error: Memory allocation failed");
+        (*env)->CallVoidMethod(env, callback, onComplete, error);
+        return;
+    }
 
-                char image_url[100];
-                sprintf(image_url, "https://ai.elliottwen.info/generate_image");
-                curl_easy_setopt(curl, CURLOPT_URL, image_url);
+    task->callback = (*env)->NewGlobalRef(env, callback);
+    task->on_complete = onComplete;
+    task->token = call_token(tokenHandle, timeoutMs);
 
-                curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-                curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    if (promptJString == NULL)
+    {
+        finish_generation(task, NULL, "Error: No prompt provided");
+        return;
+    }
 
-                struct curl_slist *image_headers = NULL;
-                image_headers = curl_slist_append(image_headers, auth_header);
-                image_headers = curl_slist_append(image_headers, "Content-Type: application/json");
-                curl_easy_setopt(curl, CURLOPT_HTTPHEADER, image_headers);
+    const char *prompt = (*env)->GetStringUTFChars(env, promptJString, NULL);
+    task->prompt = prompt != NULL ? strdup(prompt) : NULL;
+    if (prompt != NULL)
+    {
+        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
+    }
+    if (task->prompt == NULL)
+    {
+        finish_generation(task, NULL, "Error: Memory allocation failed");
+        return;
+    }
 
-                char request_body[2048];
-                sprintf(request_body, "{\"signature\":\"%s\",\"prompt\":\"%s\"}", signature, prompt);
-                curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request_body);
+    pthread_t worker;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int started = pthread_create(&worker, &attr, generation_worker, task) == 0;
+    pthread_attr_destroy(&attr);
 
-                curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-                curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&imageChunk);
+    if (!started)
+    {
+        generation_worker(task);
+    }
+}
 
-                res = curl_easy_perform(curl);
+static void on_preconnect_done(CURL *curl, CURLcode result, void *userdata)
+{
+    transport_release(curl);
+}
 
-                if (res != CURLE_OK)
-                {
-                    result = (*env)->NewStringUTF(env, "Error: Image generation request failed");
-                }
-                else
-                {
-                    char *full_url = build_full_url("https://ai.elliottwen.info", imageChunk.memory);
-                    if (full_url)
-                    {
-                        result = (*env)->NewStringUTF(env, full_url);
-                        free(full_url);
-                    }
-                    else
-                    {
-                        result = (*env)->NewStringUTF(env, imageChunk.memory);
-                    }
-                }
+static void preconnect(const char *url)
+{
+    CURL *curl = transport_acquire();
+    if (curl == NULL)
+    {
+        return;
+    }
 
-                curl_slist_free_all(image_headers);
-                free(imageChunk.memory);
-                free(signature);
-            }
-            else
-            {
-                result = (*env)->NewStringUTF(env, "Error: Failed to extract signature");
-            }
-        }
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    pinning_apply(curl);
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
 
-        curl_slist_free_all(auth_headers);
-        free(authChunk.memory);
+    if (!engine_submit(curl, NULL, on_preconnect_done, NULL))
+    {
+        transport_perform(curl);
+        transport_release(curl);
+    }
+}
 
-        curl_easy_cleanup(curl);
+JNIEXPORT jboolean JNICALL
+Java_com_example_playground_network_ApiKeyCombiner_warmUp(JNIEnv *env, jobject thiz)
+{
+    if (detect_frida())
+    {
+        return JNI_FALSE;
     }
-    else
+
+    for (size_t i = 0; i < sizeof(PRECONNECT_URLS) / sizeof(PRECONNECT_URLS[0]); i++)
     {
-        result = (*env)->NewStringUTF(env, "Error: Failed to initialize CURL");
+        preconnect(protected_string(PRECONNECT_URLS[i]));
     }
 
-    curl_global_cleanup();
+    // Nothing cancels a warm-up, but a stalled server must not pin it.
+    CancelToken *token = cancel_token_new();
+    cancel_token_set_timeout(token, WARM_UP_TIMEOUT_MS);
+
+    FragmentWorker thirdWorker;
+    FragmentWorker fourthWorker;
+    start_fragment_worker(&thirdWorker, &third_cache, third_fragment_worker, token);
+    start_fragment_worker(&fourthWorker, &fourth_cache, fourth_fragment_worker, token);
+
+    char *thirdPart = join_fragment_worker(&thirdWorker);
+    char *fourthPart = join_fragment_worker(&fourthWorker);
+    jboolean warmed = (thirdPart != NULL && fourthPart != NULL) ? JNI_TRUE : JNI_FALSE;
 
-    (*env)->ReleaseStringUTFChars(env, firstPartJString, firstPart);
-    free(secondPart);
     free(thirdPart);
-    free(fifthPart);
-    free(combinedKey);
-    (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
+    free(fourthPart);
+
+    if (warmed)
+    {
+        const char *error = NULL;
+        char *auth_header = assemble_auth_header(env, token, &error);
+        if (auth_header != NULL)
+        {
+            signature_prefetch(auth_header);
+            free(auth_header);
+        }
+    }
+
+    cancel_token_release(token);
+    return warmed;
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_playground_network_ApiKeyCombiner_configureSignatureCache(JNIEnv *env, jobject thiz,
+                                                                         jlong ttlMs, jint poolSize)
+{
+    signature_configure((long)ttlMs, (int)poolSize);
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_example_playground_network_ApiKeyCombiner_getSignatureStats(JNIEnv *env, jobject thiz)
+{
+    SignatureStats stats;
+    signature_get_stats(&stats);
+
+    jlong values[4] = {
+        stats.hits,
+        stats.misses,
+        stats.refreshes,
+        stats.rejections};
+
+    jlongArray result = (*env)->NewLongArray(env, 4);
+    if (result == NULL)
+    {
+        return NULL;
+    }
 
+    (*env)->SetLongArrayRegion(env, result, 0, 4, values);
     return result;
-}
\ No newline at end of file
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_example_playground_network_ApiKeyCombiner_createCancelToken(JNIEnv *env, jobject thiz)
+{
+    return (jlong)(intptr_t)cancel_token_new();
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_playground_network_ApiKeyCombiner_cancelToken(JNIEnv *env, jobject thiz, jlong tokenHandle)
+{
+    cancel_token_cancel((CancelToken *)(intptr_t)tokenHandle);
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_playground_network_ApiKeyCombiner_releaseCancelToken(JNIEnv *env, jobject thiz, jlong tokenHandle)
+{
+    cancel_token_release((CancelToken *)(intptr_t)tokenHandle);
+}
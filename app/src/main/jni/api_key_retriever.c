@@ -2,52 +2,15 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <openssl/evp.h>
-#include <openssl/bio.h>
-#include <openssl/buffer.h>
+#include "native_crypto.h"
+#include "protected_strings.h"
 
-char *aes_decrypt(const unsigned char *ciphertext, int ciphertext_len,
-                  const unsigned char *key, const unsigned char *iv)
+char *decrypt_fourth_fragment(const char *encryptedKeyStr)
 {
-    EVP_CIPHER_CTX *ctx;
-    int len;
-    int plaintext_len;
-    unsigned char *plaintext = (unsigned char *)malloc(ciphertext_len + EVP_MAX_BLOCK_LENGTH);
+    const unsigned char *key = (const unsigned char *)protected_string(PS_FOURTH_KEY);
+    const unsigned char *iv = (const unsigned char *)protected_string(PS_FOURTH_IV);
 
-    if (!(ctx = EVP_CIPHER_CTX_new()))
-    {
-        free(plaintext);
-        return NULL;
-    }
-
-    if (1 != EVP_DecryptInit_ex(ctx, EVP_aes_128_cbc(), NULL, key, iv))
-    {
-        EVP_CIPHER_CTX_free(ctx);
-        free(plaintext);
-        return NULL;
-    }
-
-    if (1 != EVP_DecryptUpdate(ctx, plaintext, &len, ciphertext, ciphertext_len))
-    {
-        EVP_CIPHER_CTX_free(ctx);
-        free(plaintext);
-        return NULL;
-    }
-    plaintext_len = len;
-
-    if (1 != EVP_DecryptFinal_ex(ctx, plaintext + len, &len))
-    {
-        EVP_CIPHER_CTX_free(ctx);
-        free(plaintext);
-        return NULL;
-    }
-    plaintext_len += len;
-
-    EVP_CIPHER_CTX_free(ctx);
-
-    plaintext[plaintext_len] = '\0';
-
-    return (char *)plaintext;
+    return crypto_decrypt_base64(encryptedKeyStr, key, iv);
 }
 
 JNIEXPORT jstring JNICALL Java_com_example_playground_network_ApiKeyRetriever_retrieveApiKeyNative(
@@ -125,29 +88,9 @@ JNIEXPORT jstring JNICALL Java_com_example_playground_network_ApiKeyRetriever_re
         return NULL;
     }
 
-    const unsigned char key[] = "2002012020020120";
-
-    unsigned char iv[16];
-    memset(iv, '0', 16);
-
-    BIO *b64, *bmem;
-    b64 = BIO_new(BIO_f_base64());
-    BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL);
-    bmem = BIO_new_mem_buf(encryptedKeyStr, -1);
-    bmem = BIO_push(b64, bmem);
-
-    unsigned char encrypted[1024] = {0};
-    int encryptedLen = BIO_read(bmem, encrypted, sizeof(encrypted));
-    BIO_free_all(bmem);
-
+    char *decryptedKey = decrypt_fourth_fragment(encryptedKeyStr);
     (*env)->ReleaseStringUTFChars(env, encryptedKey, encryptedKeyStr);
 
-    if (encryptedLen <= 0)
-    {
-        return NULL;
-    }
-
-    char *decryptedKey = aes_decrypt(encrypted, encryptedLen, key, iv);
     if (decryptedKey == NULL)
     {
         return NULL;
@@ -158,4 +101,4 @@ JNIEXPORT jstring JNICALL Java_com_example_playground_network_ApiKeyRetriever_re
     free(decryptedKey);
 
     return result;
-}
\ No newline at end of file
+}
@@ -0,0 +1,285 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include "native_crypto.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <tmmintrin.h>
+#define BASE64_SSSE3 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define BASE64_NEON 1
+#endif
+
+static const char ENCODE_TABLE[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// 0xFF marks bytes outside the alphabet.
+static const unsigned char DECODE_TABLE[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 62, 0xFF, 0xFF, 0xFF, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+// Decodes as many whole blocks as the vector unit handles, stopping early at
+// a block containing anything outside the alphabet. Returns the number of
+// input characters consumed; the scalar loop picks up from there.
+typedef size_t (*BlockDecoder)(const unsigned char *in, size_t len, unsigned char *out, size_t out_cap);
+
+static size_t decode_blocks_none(const unsigned char *in, size_t len, unsigned char *out, size_t out_cap)
+{
+    return 0;
+}
+
+#ifdef BASE64_SSSE3
+// 16 characters -> 12 bytes. Characters are mapped to 6-bit values with
+// range compares, then packed with multiply-add and one byte shuffle.
+__attribute__((target("ssse3"))) static size_t decode_blocks_ssse3(const unsigned char *in, size_t len,
+                                                                   unsigned char *out, size_t out_cap)
+{
+    const __m128i pack_pairs = _mm_set1_epi32(0x01400140);
+    const __m128i pack_quads = _mm_set1_epi32(0x00011000);
+    const __m128i order = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    size_t consumed = 0;
+
+    // The store writes 16 bytes for 12 decoded ones.
+    while (len - consumed >= 16 && consumed / 4 * 3 + 16 <= out_cap)
+    {
+        __m128i c = _mm_loadu_si128((const __m128i *)(in + consumed));
+
+        __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('Z' + 1)));
+        __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('z' + 1)));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+        __m128i plus = _mm_cmpeq_epi8(c, _mm_set1_epi8('+'));
+        __m128i slash = _mm_cmpeq_epi8(c, _mm_set1_epi8('/'));
+
+        __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(_mm_or_si128(digit, plus), slash));
+        if (_mm_movemask_epi8(valid) != 0xFFFF)
+        {
+            break;
+        }
+
+        __m128i shift = _mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-65)), _mm_and_si128(lower, _mm_set1_epi8(-71)));
+        shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(4)));
+        shift = _mm_or_si128(shift, _mm_and_si128(plus, _mm_set1_epi8(19)));
+        shift = _mm_or_si128(shift, _mm_and_si128(slash, _mm_set1_epi8(16)));
+        __m128i values = _mm_add_epi8(c, shift);
+
+        __m128i packed = _mm_madd_epi16(_mm_maddubs_epi16(values, pack_pairs), pack_quads);
+        _mm_storeu_si128((__m128i *)(out + consumed / 4 * 3), _mm_shuffle_epi8(packed, order));
+
+        consumed += 16;
+    }
+
+    return consumed;
+}
+
+static BlockDecoder select_decoder(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSSE3))
+    {
+        return decode_blocks_ssse3;
+    }
+    return decode_blocks_none;
+}
+#elif defined(BASE64_NEON)
+static inline uint8x16_t neon_in_range(uint8x16_t c, uint8_t lo, uint8_t hi)
+{
+    return vandq_u8(vcgeq_u8(c, vdupq_n_u8(lo)), vcleq_u8(c, vdupq_n_u8(hi)));
+}
+
+// Maps one lane of characters to 6-bit values; marks *invalid when a lane
+// holds anything outside the alphabet.
+static inline uint8x16_t neon_translate(uint8x16_t c, uint8x16_t *invalid)
+{
+    uint8x16_t upper = neon_in_range(c, 'A', 'Z');
+    uint8x16_t lower = neon_in_range(c, 'a', 'z');
+    uint8x16_t digit = neon_in_range(c, '0', '9');
+    uint8x16_t plus = vceqq_u8(c, vdupq_n_u8('+'));
+    uint8x16_t slash = vceqq_u8(c, vdupq_n_u8('/'));
+
+    uint8x16_t valid = vorrq_u8(vorrq_u8(upper, lower), vorrq_u8(vorrq_u8(digit, plus), slash));
+    *invalid = vorrq_u8(*invalid, vmvnq_u8(valid));
+
+    uint8x16_t shift = vorrq_u8(vandq_u8(upper, vdupq_n_u8((uint8_t)-65)), vandq_u8(lower, vdupq_n_u8((uint8_t)-71)));
+    shift = vorrq_u8(shift, vandq_u8(digit, vdupq_n_u8(4)));
+    shift = vorrq_u8(shift, vandq_u8(plus, vdupq_n_u8(19)));
+    shift = vorrq_u8(shift, vandq_u8(slash, vdupq_n_u8(16)));
+    return vaddq_u8(c, shift);
+}
+
+// 64 characters -> 48 bytes. vld4 splits each quad across four registers,
+// so packing is plain shifts and ors, and vst3 interleaves the result.
+static size_t decode_blocks_neon(const unsigned char *in, size_t len, unsigned char *out, size_t out_cap)
+{
+    size_t consumed = 0;
+
+    while (len - consumed >= 64 && consumed / 4 * 3 + 48 <= out_cap)
+    {
+        uint8x16x4_t c = vld4q_u8(in + consumed);
+        uint8x16_t invalid = vdupq_n_u8(0);
+
+        uint8x16_t a = neon_translate(c.val[0], &invalid);
+        uint8x16_t b = neon_translate(c.val[1], &invalid);
+        uint8x16_t d = neon_translate(c.val[2], &invalid);
+        uint8x16_t e = neon_translate(c.val[3], &invalid);
+
+        uint64x2_t any = vreinterpretq_u64_u8(invalid);
+        if ((vgetq_lane_u64(any, 0) | vgetq_lane_u64(any, 1)) != 0)
+        {
+            break;
+        }
+
+        uint8x16x3_t packed;
+        packed.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+        packed.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(d, 2));
+        packed.val[2] = vorrq_u8(vshlq_n_u8(d, 6), e);
+        vst3q_u8(out + consumed / 4 * 3, packed);
+
+        consumed += 64;
+    }
+
+    return consumed;
+}
+
+static BlockDecoder select_decoder(void)
+{
+    // NEON is baseline on every ABI this is compiled for with __ARM_NEON.
+    return decode_blocks_neon;
+}
+#else
+static BlockDecoder select_decoder(void)
+{
+    return decode_blocks_none;
+}
+#endif
+
+static pthread_once_t decoder_once = PTHREAD_ONCE_INIT;
+static BlockDecoder block_decoder = decode_blocks_none;
+
+static void init_decoder(void)
+{
+    block_decoder = select_decoder();
+}
+
+size_t crypto_base64_encoded_length(size_t len)
+{
+    return (len + 2) / 3 * 4;
+}
+
+int crypto_base64_encode(const unsigned char *input, size_t input_len, char *out, size_t out_cap)
+{
+    size_t encoded_len = crypto_base64_encoded_length(input_len);
+    if (encoded_len > INT32_MAX || out_cap < encoded_len + 1)
+    {
+        return -1;
+    }
+
+    size_t i = 0;
+    char *dst = out;
+    for (; i + 3 <= input_len; i += 3)
+    {
+        uint32_t v = (uint32_t)input[i] << 16 | (uint32_t)input[i + 1] << 8 | input[i + 2];
+        *dst++ = ENCODE_TABLE[v >> 18];
+        *dst++ = ENCODE_TABLE[(v >> 12) & 0x3F];
+        *dst++ = ENCODE_TABLE[(v >> 6) & 0x3F];
+        *dst++ = ENCODE_TABLE[v & 0x3F];
+    }
+
+    if (i < input_len)
+    {
+        uint32_t v = (uint32_t)input[i] << 16;
+        if (i + 1 < input_len)
+        {
+            v |= (uint32_t)input[i + 1] << 8;
+        }
+        *dst++ = ENCODE_TABLE[v >> 18];
+        *dst++ = ENCODE_TABLE[(v >> 12) & 0x3F];
+        *dst++ = i + 1 < input_len ? ENCODE_TABLE[(v >> 6) & 0x3F] : '=';
+        *dst++ = '=';
+    }
+
+    *dst = '\0';
+    return (int)encoded_len;
+}
+
+int crypto_base64_decode(const char *input, size_t input_len, unsigned char *out, size_t out_cap)
+{
+    const unsigned char *in = (const unsigned char *)input;
+
+    size_t padding = 0;
+    if (input_len % 4 == 0 && input_len > 0 && in[input_len - 1] == '=')
+    {
+        padding = in[input_len - 2] == '=' ? 2 : 1;
+    }
+
+    // Unpadded input is accepted as long as the trailing group is complete
+    // enough to carry a byte.
+    size_t body = input_len - padding;
+    size_t tail = body % 4;
+    if (body == 0 || tail == 1 || input_len > INT32_MAX)
+    {
+        return -1;
+    }
+
+    size_t whole = body - tail;
+    size_t decoded_len = whole / 4 * 3 + (tail == 0 ? 0 : tail - 1);
+    if (out_cap < decoded_len)
+    {
+        return -1;
+    }
+
+    pthread_once(&decoder_once, init_decoder);
+    size_t pos = block_decoder(in, whole, out, out_cap);
+
+    unsigned char *dst = out + pos / 4 * 3;
+    for (; pos < whole; pos += 4)
+    {
+        uint32_t a = DECODE_TABLE[in[pos]];
+        uint32_t b = DECODE_TABLE[in[pos + 1]];
+        uint32_t c = DECODE_TABLE[in[pos + 2]];
+        uint32_t d = DECODE_TABLE[in[pos + 3]];
+        if ((a | b | c | d) & 0x80)
+        {
+            return -1;
+        }
+
+        uint32_t v = a << 18 | b << 12 | c << 6 | d;
+        *dst++ = (unsigned char)(v >> 16);
+        *dst++ = (unsigned char)(v >> 8);
+        *dst++ = (unsigned char)v;
+    }
+
+    if (tail > 0)
+    {
+        uint32_t a = DECODE_TABLE[in[whole]];
+        uint32_t b = DECODE_TABLE[in[whole + 1]];
+        uint32_t c = tail == 3 ? DECODE_TABLE[in[whole + 2]] : 0;
+        if ((a | b | c) & 0x80)
+        {
+            return -1;
+        }
+
+        uint32_t v = a << 18 | b << 12 | c << 6;
+        *dst++ = (unsigned char)(v >> 16);
+        if (tail == 3)
+        {
+            *dst++ = (unsigned char)(v >> 8);
+        }
+    }
+
+    return (int)decoded_len;
+}
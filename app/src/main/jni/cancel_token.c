@@ -0,0 +1,102 @@
+#include <stdlib.h>
+#include <time.h>
+#include "cancel_token.h"
+#include "http_engine.h"
+
+long long monotonic_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+CancelToken *cancel_token_new(void)
+{
+    CancelToken *token = (CancelToken *)malloc(sizeof(CancelToken));
+    if (token == NULL)
+    {
+        return NULL;
+    }
+
+    atomic_init(&token->cancelled, 0);
+    atomic_init(&token->refs, 1);
+    atomic_init(&token->deadline_ms, 0);
+    return token;
+}
+
+CancelToken *cancel_token_retain(CancelToken *token)
+{
+    if (token != NULL)
+    {
+        atomic_fetch_add(&token->refs, 1);
+    }
+    return token;
+}
+
+void cancel_token_release(CancelToken *token)
+{
+    if (token != NULL && atomic_fetch_sub(&token->refs, 1) == 1)
+    {
+        free(token);
+    }
+}
+
+void cancel_token_cancel(CancelToken *token)
+{
+    if (token == NULL)
+    {
+        return;
+    }
+
+    atomic_store(&token->cancelled, 1);
+    engine_wakeup();
+}
+
+void cancel_token_set_timeout(CancelToken *token, long timeout_ms)
+{
+    if (token != NULL && timeout_ms > 0)
+    {
+        atomic_store(&token->deadline_ms, monotonic_ms() + timeout_ms);
+    }
+}
+
+int cancel_token_expired(CancelToken *token)
+{
+    if (token == NULL)
+    {
+        return 0;
+    }
+
+    if (atomic_load(&token->cancelled))
+    {
+        return 1;
+    }
+
+    long long deadline = atomic_load(&token->deadline_ms);
+    return deadline > 0 && monotonic_ms() >= deadline;
+}
+
+static int xferinfo_callback(void *clientp, curl_off_t dltotal, curl_off_t dlnow,
+                             curl_off_t ultotal, curl_off_t ulnow)
+{
+    return cancel_token_expired((CancelToken *)clientp);
+}
+
+void cancel_token_apply(CancelToken *token, CURL *curl)
+{
+    if (token == NULL)
+    {
+        return;
+    }
+
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, xferinfo_callback);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, token);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+
+    long long deadline = atomic_load(&token->deadline_ms);
+    if (deadline > 0)
+    {
+        long long remaining = deadline - monotonic_ms();
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long)(remaining > 1 ? remaining : 1));
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef CANCEL_TOKEN_H
+#define CANCEL_TOKEN_H
+
+#include <stdatomic.h>
+#include <curl/curl.h>
+
+typedef struct
+{
+    atomic_int cancelled;
+    atomic_int refs;
+    atomic_llong deadline_ms;
+} CancelToken;
+
+long long monotonic_ms(void);
+
+CancelToken *cancel_token_new(void);
+CancelToken *cancel_token_retain(CancelToken *token);
+void cancel_token_release(CancelToken *token);
+void cancel_token_cancel(CancelToken *token);
+void cancel_token_set_timeout(CancelToken *token, long timeout_ms);
+int cancel_token_expired(CancelToken *token);
+void cancel_token_apply(CancelToken *token, CURL *curl);
+
+#endif
@@ -0,0 +1,187 @@
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <openssl/ssl.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/sha.h>
+#include <openssl/x509.h>
+#include <openssl/x509_vfy.h>
+#include "cert_pinning.h"
+#include "native_crypto.h"
+
+#define SPKI_DER_MAX 2048
+#define SYSTEM_CA_DIR "/system/etc/security/cacerts"
+
+static unsigned char pin_set[PIN_MAX_COUNT][PIN_SHA256_LEN] = {
+    {0x2b, 0xba, 0xd9, 0x3a, 0xb5, 0xc7, 0x92, 0x79, 0xec, 0x12, 0x15, 0x07, 0xf2, 0x72, 0xcb, 0xe0,
+     0xc6, 0x64, 0x7a, 0x3a, 0xae, 0x52, 0xe2, 0x2f, 0x38, 0x8a, 0xfa, 0xb4, 0x26, 0xb4, 0xad, 0xba}};
+static atomic_int pin_count = 1;
+static pthread_mutex_t pin_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static STACK_OF(X509) *system_roots = NULL;
+static pthread_once_t system_roots_once = PTHREAD_ONCE_INIT;
+
+static int pin_known(const unsigned char *digest, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (CRYPTO_memcmp(pin_set[i], digest, PIN_SHA256_LEN) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int pinning_add_pin(const char *pin)
+{
+    const char *prefix = "sha256/";
+    size_t prefix_len = strlen(prefix);
+    if (pin == NULL || strncmp(pin, prefix, prefix_len) != 0)
+    {
+        return 0;
+    }
+
+    const char *encoded = pin + prefix_len;
+    size_t encoded_len = strlen(encoded);
+    if (encoded_len != 44)
+    {
+        return 0;
+    }
+
+    unsigned char decoded[PIN_SHA256_LEN];
+    if (crypto_base64_decode(encoded, encoded_len, decoded, sizeof(decoded)) != PIN_SHA256_LEN)
+    {
+        return 0;
+    }
+
+    int added = 0;
+    pthread_mutex_lock(&pin_lock);
+    int count = atomic_load(&pin_count);
+    if (pin_known(decoded, count))
+    {
+        added = 1;
+    }
+    else if (count < PIN_MAX_COUNT)
+    {
+        memcpy(pin_set[count], decoded, PIN_SHA256_LEN);
+        atomic_store(&pin_count, count + 1);
+        added = 1;
+    }
+    pthread_mutex_unlock(&pin_lock);
+
+    return added;
+}
+
+static int spki_pinned(X509 *cert, int count)
+{
+    X509_PUBKEY *pubkey = X509_get_X509_PUBKEY(cert);
+    int der_len = i2d_X509_PUBKEY(pubkey, NULL);
+    if (der_len <= 0 || der_len > SPKI_DER_MAX)
+    {
+        return 0;
+    }
+
+    unsigned char der[SPKI_DER_MAX];
+    unsigned char *p = der;
+    if (i2d_X509_PUBKEY(pubkey, &p) != der_len)
+    {
+        return 0;
+    }
+
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    SHA256(der, (size_t)der_len, digest);
+
+    return pin_known(digest, count);
+}
+
+// Android names its system CA files by the old subject hash, which OpenSSL
+// 1.1 cannot look up through CAPATH, so the roots are read once and added
+// to each handshake's store. User-installed CAs are deliberately left out.
+static void load_system_roots(void)
+{
+    system_roots = sk_X509_new_null();
+    DIR *dir = opendir(SYSTEM_CA_DIR);
+    if (system_roots == NULL || dir == NULL)
+    {
+        if (dir != NULL)
+        {
+            closedir(dir);
+        }
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (entry->d_name[0] == '.')
+        {
+            continue;
+        }
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", SYSTEM_CA_DIR, entry->d_name);
+        FILE *fp = fopen(path, "r");
+        if (fp == NULL)
+        {
+            continue;
+        }
+
+        X509 *root = PEM_read_X509(fp, NULL, NULL, NULL);
+        fclose(fp);
+        if (root != NULL && !sk_X509_push(system_roots, root))
+        {
+            X509_free(root);
+        }
+    }
+    closedir(dir);
+}
+
+// The chain is verified against the system roots first; pins are then
+// matched only on that verified chain, never on what the peer sent.
+static int pin_verify_callback(X509_STORE_CTX *store, void *arg)
+{
+    if (X509_verify_cert(store) <= 0)
+    {
+        return 0;
+    }
+
+    STACK_OF(X509) *chain = X509_STORE_CTX_get0_chain(store);
+    int count = atomic_load(&pin_count);
+
+    for (int i = 0; chain != NULL && i < sk_X509_num(chain); i++)
+    {
+        if (spki_pinned(sk_X509_value(chain, i), count))
+        {
+            return 1;
+        }
+    }
+
+    X509_STORE_CTX_set_error(store, X509_V_ERR_APPLICATION_VERIFICATION);
+    return 0;
+}
+
+static CURLcode pin_ssl_ctx_callback(CURL *curl, void *ssl_ctx, void *userptr)
+{
+    pthread_once(&system_roots_once, load_system_roots);
+
+    X509_STORE *roots = SSL_CTX_get_cert_store((SSL_CTX *)ssl_ctx);
+    for (int i = 0; system_roots != NULL && i < sk_X509_num(system_roots); i++)
+    {
+        X509_STORE_add_cert(roots, sk_X509_value(system_roots, i));
+    }
+
+    SSL_CTX_set_cert_verify_callback((SSL_CTX *)ssl_ctx, pin_verify_callback, NULL);
+    return CURLE_OK;
+}
+
+void pinning_apply(CURL *curl)
+{
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+    curl_easy_setopt(curl, CURLOPT_SSL_CTX_FUNCTION, pin_ssl_ctx_callback);
+}
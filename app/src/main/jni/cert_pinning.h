@@ -0,0 +1,12 @@
+#ifndef CERT_PINNING_H
+#define CERT_PINNING_H
+
+#include <curl/curl.h>
+
+#define PIN_SHA256_LEN 32
+#define PIN_MAX_COUNT 8
+
+int pinning_add_pin(const char *pin);
+void pinning_apply(CURL *curl);
+
+#endif
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include "exif_fetch.h"
+#include "exif_stream.h"
+#include "http_engine.h"
+
+typedef struct
+{
+    ExifStream stream;
+    CURL *curl;
+    size_t response_start;
+} ExifFetch;
+
+static size_t exif_write_callback(void *contents, size_t size, size_t nmemb, void *userp)
+{
+    size_t realsize = size * nmemb;
+    ExifFetch *fetch = (ExifFetch *)userp;
+    ExifStream *stream = &fetch->stream;
+
+    if (exif_stream_feed(stream, (const unsigned char *)contents, realsize) == EXIF_NEED_MORE)
+    {
+        // Too far in for metadata.
+        return stream->bytes_seen > EXIF_SCAN_MAX ? 0 : realsize;
+    }
+
+    // The parser has a verdict, so the transfer ends here. Only the tail of a
+    // range window short enough to drain is received, to keep the connection
+    // reusable; a 200 answer carries the whole image and is always cut off.
+    long http_code = 0;
+    curl_off_t length = -1;
+    curl_easy_getinfo(fetch->curl, CURLINFO_RESPONSE_CODE, &http_code);
+    curl_easy_getinfo(fetch->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+    curl_off_t received = (curl_off_t)(stream->bytes_seen - fetch->response_start);
+    if (http_code != 206 || length < 0 || length - received > EXIF_DRAIN_MAX)
+    {
+        return 0;
+    }
+    return realsize;
+}
+
+// Requests only the head of the image with HTTP ranges, growing the window
+// until the parser has a verdict. A server that ignores Range answers 200 and
+// the whole body streams through the parser instead, and is cut off at the
+// verdict or the scan limit.
+char *exif_fetch_comment(CURL *curl, const char *image_url, CancelToken *token)
+{
+    ExifFetch fetch;
+    ExifStream *stream = &fetch.stream;
+    exif_stream_init(stream);
+    fetch.curl = curl;
+
+    curl_easy_setopt(curl, CURLOPT_URL, image_url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, exif_write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&fetch);
+
+    size_t offset = 0;
+    size_t window = EXIF_RANGE_INITIAL;
+
+    while (stream->status == EXIF_NEED_MORE)
+    {
+        char range[64];
+        snprintf(range, sizeof(range), "%zu-%zu", offset, offset + window - 1);
+        curl_easy_setopt(curl, CURLOPT_RANGE, range);
+
+        fetch.response_start = stream->bytes_seen;
+        CURLcode res = engine_perform(curl, token);
+        long http_code = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+
+        // A verdict ends the scan whatever the transfer result; a server that
+        // ignored Range has already sent everything it is going to.
+        if (stream->status != EXIF_NEED_MORE || http_code != 206 || res != CURLE_OK)
+        {
+            break;
+        }
+
+        size_t received = stream->bytes_seen - offset;
+        if (received < window || stream->bytes_seen >= EXIF_SCAN_MAX)
+        {
+            // End of the image, or too far in for metadata.
+            break;
+        }
+
+        offset = stream->bytes_seen;
+        window *= 2;
+
+        size_t wanted = exif_stream_wanted(stream);
+        if (wanted > window)
+        {
+            window = wanted;
+        }
+        if (window > EXIF_RANGE_MAX)
+        {
+            window = EXIF_RANGE_MAX;
+        }
+    }
+
+    char *comment = exif_stream_take_comment(stream);
+    exif_stream_free(stream);
+    return comment;
+}
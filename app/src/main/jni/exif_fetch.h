@@ -0,0 +1,18 @@
+#ifndef EXIF_FETCH_H
+#define EXIF_FETCH_H
+
+#include <curl/curl.h>
+#include "cancel_token.h"
+
+#define EXIF_RANGE_INITIAL 16384
+#define EXIF_RANGE_MAX (256 * 1024)
+#define EXIF_SCAN_MAX (1024 * 1024)
+#define EXIF_DRAIN_MAX 4096
+
+// Reads the EXIF UserComment of the image at image_url through the engine,
+// fetching no more of the image than the scan needs. The handle's TLS setup
+// is left to the caller. Returns a malloc'd string, or NULL when there is no
+// comment or the transfer fails.
+char *exif_fetch_comment(CURL *curl, const char *image_url, CancelToken *token);
+
+#endif
@@ -0,0 +1,337 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "exif_stream.h"
+
+enum
+{
+    STATE_SOI,
+    STATE_MARKER,
+    STATE_LENGTH,
+    STATE_SKIP,
+    STATE_APP1,
+    STATE_DONE
+};
+
+#define TAG_EXIF_IFD 0x8769
+#define TAG_USER_COMMENT 0x9286
+#define FORMAT_UNDEFINED 7
+#define FORMAT_ASCII 2
+
+static const unsigned char EXIF_HEADER[6] = {'E', 'x', 'i', 'f', 0, 0};
+static const unsigned char ASCII_PREFIX[8] = {'A', 'S', 'C', 'I', 'I', 0, 0, 0};
+
+typedef struct
+{
+    const unsigned char *base;
+    size_t len;
+    int big_endian;
+} Tiff;
+
+static int read_u16(const Tiff *tiff, size_t offset, uint32_t *out)
+{
+    if (offset > tiff->len || tiff->len - offset < 2)
+    {
+        return 0;
+    }
+
+    const unsigned char *p = tiff->base + offset;
+    *out = tiff->big_endian ? ((uint32_t)p[0] << 8) | p[1] : ((uint32_t)p[1] << 8) | p[0];
+    return 1;
+}
+
+static int read_u32(const Tiff *tiff, size_t offset, uint32_t *out)
+{
+    if (offset > tiff->len || tiff->len - offset < 4)
+    {
+        return 0;
+    }
+
+    const unsigned char *p = tiff->base + offset;
+    *out = tiff->big_endian
+               ? ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]
+               : ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+    return 1;
+}
+
+// Same conversion ExifInterface applies to UNDEFINED/ASCII values: drop the
+// "ASCII\0\0\0" charset prefix, stop at the first NUL and replace control or
+// non-ASCII bytes with '?'.
+static char *decode_comment(const unsigned char *value, size_t count)
+{
+    size_t index = 0;
+    if (count >= sizeof(ASCII_PREFIX) && memcmp(value, ASCII_PREFIX, sizeof(ASCII_PREFIX)) == 0)
+    {
+        index = sizeof(ASCII_PREFIX);
+    }
+
+    char *comment = (char *)malloc(count - index + 1);
+    if (comment == NULL)
+    {
+        return NULL;
+    }
+
+    size_t out = 0;
+    for (; index < count && value[index] != 0; index++)
+    {
+        unsigned char ch = value[index];
+        comment[out++] = (ch >= 32 && ch < 128) ? (char)ch : '?';
+    }
+    comment[out] = '\0';
+
+    if (out == 0)
+    {
+        free(comment);
+        return NULL;
+    }
+    return comment;
+}
+
+static char *find_comment(const Tiff *tiff, uint32_t ifd_offset, int depth)
+{
+    uint32_t entries;
+    if (depth > 2 || !read_u16(tiff, ifd_offset, &entries))
+    {
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < entries; i++)
+    {
+        size_t entry = (size_t)ifd_offset + 2 + (size_t)i * 12;
+        uint32_t tag, format, count, value;
+        if (!read_u16(tiff, entry, &tag) || !read_u16(tiff, entry + 2, &format) ||
+            !read_u32(tiff, entry + 4, &count) || !read_u32(tiff, entry + 8, &value))
+        {
+            return NULL;
+        }
+
+        if (tag == TAG_USER_COMMENT && (format == FORMAT_UNDEFINED || format == FORMAT_ASCII))
+        {
+            size_t data = count <= 4 ? entry + 8 : value;
+            if (data > tiff->len || tiff->len - data < count)
+            {
+                return NULL;
+            }
+            return decode_comment(tiff->base + data, count);
+        }
+
+        if (tag == TAG_EXIF_IFD)
+        {
+            char *comment = find_comment(tiff, value, depth + 1);
+            if (comment != NULL)
+            {
+                return comment;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static char *parse_app1(const unsigned char *segment, size_t len)
+{
+    if (len < sizeof(EXIF_HEADER) + 8 || memcmp(segment, EXIF_HEADER, sizeof(EXIF_HEADER)) != 0)
+    {
+        return NULL;
+    }
+
+    Tiff tiff;
+    tiff.base = segment + sizeof(EXIF_HEADER);
+    tiff.len = len - sizeof(EXIF_HEADER);
+
+    if (tiff.base[0] == 'I' && tiff.base[1] == 'I')
+    {
+        tiff.big_endian = 0;
+    }
+    else if (tiff.base[0] == 'M' && tiff.base[1] == 'M')
+    {
+        tiff.big_endian = 1;
+    }
+    else
+    {
+        return NULL;
+    }
+
+    uint32_t magic, ifd0;
+    if (!read_u16(&tiff, 2, &magic) || magic != 42 || !read_u32(&tiff, 4, &ifd0))
+    {
+        return NULL;
+    }
+
+    return find_comment(&tiff, ifd0, 0);
+}
+
+static void finish(ExifStream *stream, ExifStatus status)
+{
+    stream->state = STATE_DONE;
+    stream->status = status;
+    free(stream->segment);
+    stream->segment = NULL;
+}
+
+void exif_stream_init(ExifStream *stream)
+{
+    memset(stream, 0, sizeof(ExifStream));
+    stream->state = STATE_SOI;
+    stream->status = EXIF_NEED_MORE;
+}
+
+ExifStatus exif_stream_feed(ExifStream *stream, const unsigned char *data, size_t len)
+{
+    size_t pos = 0;
+    stream->bytes_seen += len;
+
+    while (pos < len && stream->state != STATE_DONE)
+    {
+        switch (stream->state)
+        {
+        case STATE_SOI:
+            stream->header[stream->header_pos++] = data[pos++];
+            if (stream->header_pos == 2)
+            {
+                if (stream->header[0] != 0xFF || stream->header[1] != 0xD8)
+                {
+                    finish(stream, EXIF_NOT_FOUND);
+                    break;
+                }
+                stream->header_pos = 0;
+                stream->state = STATE_MARKER;
+            }
+            break;
+
+        case STATE_MARKER:
+        {
+            unsigned char byte = data[pos++];
+            if (stream->header_pos == 0)
+            {
+                if (byte != 0xFF)
+                {
+                    finish(stream, EXIF_NOT_FOUND);
+                    break;
+                }
+                stream->header_pos = 1;
+            }
+            else if (byte == 0xFF)
+            {
+                // fill byte
+            }
+            else if (byte == 0xDA || byte == 0xD9)
+            {
+                // Exif metadata always precedes the scan data.
+                finish(stream, EXIF_NOT_FOUND);
+            }
+            else if (byte == 0x01 || (byte >= 0xD0 && byte <= 0xD7))
+            {
+                stream->header_pos = 0;
+            }
+            else
+            {
+                stream->header[1] = byte;
+                stream->header_pos = 0;
+                stream->state = STATE_LENGTH;
+            }
+            break;
+        }
+
+        case STATE_LENGTH:
+            stream->header[2 + stream->header_pos++] = data[pos++];
+            if (stream->header_pos == 2)
+            {
+                size_t length = ((size_t)stream->header[2] << 8) | stream->header[3];
+                stream->header_pos = 0;
+                if (length < 2)
+                {
+                    finish(stream, EXIF_NOT_FOUND);
+                    break;
+                }
+
+                stream->remaining = length - 2;
+                if (stream->header[1] == 0xE1 && stream->remaining > 0)
+                {
+                    stream->segment = (unsigned char *)malloc(stream->remaining);
+                    if (stream->segment == NULL)
+                    {
+                        finish(stream, EXIF_NOT_FOUND);
+                        break;
+                    }
+                    stream->segment_len = stream->remaining;
+                    stream->segment_pos = 0;
+                    stream->state = STATE_APP1;
+                }
+                else
+                {
+                    stream->state = stream->remaining > 0 ? STATE_SKIP : STATE_MARKER;
+                }
+            }
+            break;
+
+        case STATE_SKIP:
+        {
+            size_t take = len - pos < stream->remaining ? len - pos : stream->remaining;
+            pos += take;
+            stream->remaining -= take;
+            if (stream->remaining == 0)
+            {
+                stream->state = STATE_MARKER;
+            }
+            break;
+        }
+
+        case STATE_APP1:
+        {
+            size_t take = len - pos < stream->remaining ? len - pos : stream->remaining;
+            memcpy(stream->segment + stream->segment_pos, data + pos, take);
+            stream->segment_pos += take;
+            pos += take;
+            stream->remaining -= take;
+
+            if (stream->remaining == 0)
+            {
+                char *comment = parse_app1(stream->segment, stream->segment_len);
+                free(stream->segment);
+                stream->segment = NULL;
+
+                if (comment != NULL)
+                {
+                    stream->user_comment = comment;
+                    finish(stream, EXIF_FOUND);
+                }
+                else
+                {
+                    // Not Exif (e.g. XMP) or no UserComment; keep scanning.
+                    stream->state = STATE_MARKER;
+                }
+            }
+            break;
+        }
+        }
+    }
+
+    return stream->status;
+}
+
+// Bytes still needed to finish the segment being read, so a ranged fetch can
+// size its next request to cover the whole APP1 segment.
+size_t exif_stream_wanted(const ExifStream *stream)
+{
+    if (stream->state == STATE_APP1 || stream->state == STATE_SKIP)
+    {
+        return stream->remaining;
+    }
+    return 0;
+}
+
+char *exif_stream_take_comment(ExifStream *stream)
+{
+    char *comment = stream->user_comment;
+    stream->user_comment = NULL;
+    return comment;
+}
+
+void exif_stream_free(ExifStream *stream)
+{
+    free(stream->segment);
+    free(stream->user_comment);
+    stream->segment = NULL;
+    stream->user_comment = NULL;
+}
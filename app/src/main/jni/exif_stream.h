@@ -0,0 +1,38 @@
+#ifndef EXIF_STREAM_H
+#define EXIF_STREAM_H
+
+#include <stddef.h>
+
+#define EXIF_APP1_MAX 65535
+
+typedef enum
+{
+    EXIF_NEED_MORE,
+    EXIF_FOUND,
+    EXIF_NOT_FOUND
+} ExifStatus;
+
+// Incremental JPEG scanner that only keeps APP1 (Exif) segment bytes; every
+// other segment is skipped as it streams past. Parsing ends at the first
+// UserComment found, or at the start of scan data.
+typedef struct
+{
+    int state;
+    size_t header_pos;
+    unsigned char header[4];
+    size_t remaining;
+    unsigned char *segment;
+    size_t segment_len;
+    size_t segment_pos;
+    size_t bytes_seen;
+    char *user_comment;
+    ExifStatus status;
+} ExifStream;
+
+void exif_stream_init(ExifStream *stream);
+ExifStatus exif_stream_feed(ExifStream *stream, const unsigned char *data, size_t len);
+size_t exif_stream_wanted(const ExifStream *stream);
+char *exif_stream_take_comment(ExifStream *stream);
+void exif_stream_free(ExifStream *stream);
+
+#endif
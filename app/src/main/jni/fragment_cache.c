@@ -0,0 +1,97 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "fragment_cache.h"
+
+char *fragment_cache_peek(FragmentCache *cache)
+{
+    char *value = atomic_load_explicit(&cache->value, memory_order_acquire);
+    return value != NULL ? strdup(value) : NULL;
+}
+
+// Caller holds cache->lock. Waits in short slices so a waiter notices its
+// own cancellation or deadline while another caller's fetch is running.
+static void wait_for_flight(FragmentCache *cache)
+{
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_nsec += FRAGMENT_WAIT_SLICE_MS * 1000000L;
+    if (until.tv_nsec >= 1000000000L)
+    {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&cache->cond, &cache->lock, &until);
+}
+
+// Published values are never replaced, so readers only need the atomic load.
+// Concurrent misses wait for the fetch already in flight instead of starting
+// their own; if that fetch fails they all fail with it, unless it was only
+// aborted by its own caller's token, in which case a live waiter takes over.
+char *fragment_cache_get(FragmentCache *cache, FragmentFetch fetch, CancelToken *token, void *ctx)
+{
+    char *value = fragment_cache_peek(cache);
+    if (value != NULL)
+    {
+        return value;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    for (;;)
+    {
+        value = fragment_cache_peek(cache);
+        if (value != NULL || cancel_token_expired(token))
+        {
+            pthread_mutex_unlock(&cache->lock);
+            return value;
+        }
+
+        if (!cache->fetching)
+        {
+            break;
+        }
+
+        unsigned long flight = cache->flights;
+        while (cache->fetching && cache->flights == flight && !cancel_token_expired(token))
+        {
+            wait_for_flight(cache);
+        }
+
+        if (cache->flights != flight && !cache->aborted)
+        {
+            pthread_mutex_unlock(&cache->lock);
+            return fragment_cache_peek(cache);
+        }
+    }
+
+    cache->fetching = 1;
+    pthread_mutex_unlock(&cache->lock);
+
+    value = fetch(token, ctx);
+    if (value != NULL)
+    {
+        char *published = strdup(value);
+        char *expected = NULL;
+        if (published != NULL &&
+            !atomic_compare_exchange_strong_explicit(&cache->value, &expected, published,
+                                                     memory_order_acq_rel, memory_order_acquire))
+        {
+            free(published);
+        }
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    cache->fetching = 0;
+    cache->aborted = value == NULL && cancel_token_expired(token);
+    cache->flights++;
+    pthread_cond_broadcast(&cache->cond);
+    pthread_mutex_unlock(&cache->lock);
+
+    return value;
+}
+
+// Only safe once no caller can still be reading the cache (library unload).
+void fragment_cache_clear(FragmentCache *cache)
+{
+    free(atomic_exchange(&cache->value, NULL));
+}
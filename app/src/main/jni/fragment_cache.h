@@ -0,0 +1,29 @@
+#ifndef FRAGMENT_CACHE_H
+#define FRAGMENT_CACHE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "cancel_token.h"
+
+#define FRAGMENT_WAIT_SLICE_MS 20
+
+// Returns an owned value, or NULL when the fetch failed.
+typedef char *(*FragmentFetch)(CancelToken *token, void *ctx);
+
+typedef struct
+{
+    _Atomic(char *) value;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int fetching;
+    int aborted;
+    unsigned long flights;
+} FragmentCache;
+
+#define FRAGMENT_CACHE_INIT {NULL, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, 0}
+
+char *fragment_cache_peek(FragmentCache *cache);
+char *fragment_cache_get(FragmentCache *cache, FragmentFetch fetch, CancelToken *token, void *ctx);
+void fragment_cache_clear(FragmentCache *cache);
+
+#endif
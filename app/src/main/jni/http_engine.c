@@ -0,0 +1,279 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include "http_engine.h"
+#include "http_transport.h"
+
+typedef struct EngineTransfer
+{
+    CURL *curl;
+    CancelToken *token;
+    EngineCallback callback;
+    void *userdata;
+    struct EngineTransfer *prev;
+    struct EngineTransfer *next;
+} EngineTransfer;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int done;
+    CURLcode result;
+} SyncWaiter;
+
+static pthread_once_t engine_once = PTHREAD_ONCE_INIT;
+static int engine_ready = 0;
+
+static CURLM *multi_handle = NULL;
+static pthread_t engine_thread;
+
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static EngineTransfer *pending_head = NULL;
+static EngineTransfer *pending_tail = NULL;
+
+static EngineTransfer *active_head = NULL;
+
+static void link_active(EngineTransfer *transfer)
+{
+    transfer->prev = NULL;
+    transfer->next = active_head;
+    if (active_head != NULL)
+    {
+        active_head->prev = transfer;
+    }
+    active_head = transfer;
+}
+
+static void unlink_active(EngineTransfer *transfer)
+{
+    if (transfer->prev != NULL)
+    {
+        transfer->prev->next = transfer->next;
+    }
+    else
+    {
+        active_head = transfer->next;
+    }
+
+    if (transfer->next != NULL)
+    {
+        transfer->next->prev = transfer->prev;
+    }
+}
+
+static void complete_transfer(EngineTransfer *transfer, CURLcode result)
+{
+    transfer->callback(transfer->curl, result, transfer->userdata);
+    cancel_token_release(transfer->token);
+    free(transfer);
+}
+
+static void drain_pending(void)
+{
+    pthread_mutex_lock(&queue_lock);
+    EngineTransfer *transfer = pending_head;
+    pending_head = NULL;
+    pending_tail = NULL;
+    pthread_mutex_unlock(&queue_lock);
+
+    while (transfer != NULL)
+    {
+        EngineTransfer *next = transfer->next;
+
+        if (cancel_token_expired(transfer->token))
+        {
+            complete_transfer(transfer, CURLE_ABORTED_BY_CALLBACK);
+        }
+        else
+        {
+            cancel_token_apply(transfer->token, transfer->curl);
+            curl_easy_setopt(transfer->curl, CURLOPT_PRIVATE, transfer);
+            if (curl_multi_add_handle(multi_handle, transfer->curl) != CURLM_OK)
+            {
+                complete_transfer(transfer, CURLE_FAILED_INIT);
+            }
+            else
+            {
+                link_active(transfer);
+            }
+        }
+
+        transfer = next;
+    }
+}
+
+static void abort_expired(void)
+{
+    EngineTransfer *transfer = active_head;
+
+    while (transfer != NULL)
+    {
+        EngineTransfer *next = transfer->next;
+
+        if (cancel_token_expired(transfer->token))
+        {
+            unlink_active(transfer);
+            curl_multi_remove_handle(multi_handle, transfer->curl);
+            complete_transfer(transfer, CURLE_ABORTED_BY_CALLBACK);
+        }
+
+        transfer = next;
+    }
+}
+
+static void dispatch_completed(void)
+{
+    CURLMsg *msg;
+    int remaining;
+
+    while ((msg = curl_multi_info_read(multi_handle, &remaining)) != NULL)
+    {
+        if (msg->msg != CURLMSG_DONE)
+        {
+            continue;
+        }
+
+        CURL *curl = msg->easy_handle;
+        CURLcode result = msg->data.result;
+        EngineTransfer *transfer = NULL;
+
+        curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char **)&transfer);
+        curl_multi_remove_handle(multi_handle, curl);
+        transport_account(curl, result);
+
+        if (transfer != NULL)
+        {
+            unlink_active(transfer);
+            complete_transfer(transfer, result);
+        }
+    }
+}
+
+static void *engine_loop(void *arg)
+{
+    int running = 0;
+
+    for (;;)
+    {
+        drain_pending();
+        abort_expired();
+        curl_multi_perform(multi_handle, &running);
+        dispatch_completed();
+        curl_multi_poll(multi_handle, NULL, 0, 1000, NULL);
+    }
+
+    return NULL;
+}
+
+static void engine_start_once(void)
+{
+    if (!transport_init())
+    {
+        return;
+    }
+
+    multi_handle = curl_multi_init();
+    if (multi_handle == NULL)
+    {
+        return;
+    }
+
+    if (pthread_create(&engine_thread, NULL, engine_loop, NULL) != 0)
+    {
+        curl_multi_cleanup(multi_handle);
+        multi_handle = NULL;
+        return;
+    }
+
+    pthread_detach(engine_thread);
+    engine_ready = 1;
+}
+
+int engine_start(void)
+{
+    pthread_once(&engine_once, engine_start_once);
+    return engine_ready;
+}
+
+void engine_wakeup(void)
+{
+    if (engine_ready)
+    {
+        curl_multi_wakeup(multi_handle);
+    }
+}
+
+int engine_submit(CURL *curl, CancelToken *token, EngineCallback callback, void *userdata)
+{
+    if (!engine_start())
+    {
+        return 0;
+    }
+
+    EngineTransfer *transfer = (EngineTransfer *)malloc(sizeof(EngineTransfer));
+    if (transfer == NULL)
+    {
+        return 0;
+    }
+
+    transfer->curl = curl;
+    transfer->token = cancel_token_retain(token);
+    transfer->callback = callback;
+    transfer->userdata = userdata;
+    transfer->prev = NULL;
+    transfer->next = NULL;
+
+    pthread_mutex_lock(&queue_lock);
+    if (pending_tail != NULL)
+    {
+        pending_tail->next = transfer;
+    }
+    else
+    {
+        pending_head = transfer;
+    }
+    pending_tail = transfer;
+    pthread_mutex_unlock(&queue_lock);
+
+    curl_multi_wakeup(multi_handle);
+    return 1;
+}
+
+static void on_sync_done(CURL *curl, CURLcode result, void *userdata)
+{
+    SyncWaiter *waiter = (SyncWaiter *)userdata;
+
+    pthread_mutex_lock(&waiter->lock);
+    waiter->result = result;
+    waiter->done = 1;
+    pthread_cond_signal(&waiter->cond);
+    pthread_mutex_unlock(&waiter->lock);
+}
+
+CURLcode engine_perform(CURL *curl, CancelToken *token)
+{
+    SyncWaiter waiter;
+    pthread_mutex_init(&waiter.lock, NULL);
+    pthread_cond_init(&waiter.cond, NULL);
+    waiter.done = 0;
+    waiter.result = CURLE_FAILED_INIT;
+
+    if (!engine_submit(curl, token, on_sync_done, &waiter))
+    {
+        cancel_token_apply(token, curl);
+        waiter.result = transport_perform(curl);
+        waiter.done = 1;
+    }
+
+    pthread_mutex_lock(&waiter.lock);
+    while (!waiter.done)
+    {
+        pthread_cond_wait(&waiter.cond, &waiter.lock);
+    }
+    pthread_mutex_unlock(&waiter.lock);
+
+    pthread_cond_destroy(&waiter.cond);
+    pthread_mutex_destroy(&waiter.lock);
+
+    return waiter.result;
+}
@@ -0,0 +1,14 @@
+#ifndef HTTP_ENGINE_H
+#define HTTP_ENGINE_H
+
+#include <curl/curl.h>
+#include "cancel_token.h"
+
+typedef void (*EngineCallback)(CURL *curl, CURLcode result, void *userdata);
+
+int engine_start(void);
+int engine_submit(CURL *curl, CancelToken *token, EngineCallback callback, void *userdata);
+CURLcode engine_perform(CURL *curl, CancelToken *token);
+void engine_wakeup(void);
+
+#endif
@@ -0,0 +1,217 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include "http_transport.h"
+
+static pthread_mutex_t init_lock = PTHREAD_MUTEX_INITIALIZER;
+static int init_refs = 0;
+static atomic_int transport_ready;
+
+static CURLSH *shared_handle = NULL;
+static pthread_mutex_t share_locks[CURL_LOCK_DATA_LAST];
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static CURL *handle_pool[TRANSPORT_POOL_SIZE];
+static int pool_count = 0;
+
+static atomic_long stat_handle_hits;
+static atomic_long stat_handle_misses;
+static atomic_long stat_connection_reuses;
+static atomic_long stat_connection_opens;
+
+static void share_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr)
+{
+    pthread_mutex_lock(&share_locks[data]);
+}
+
+static void share_unlock(CURL *handle, curl_lock_data data, void *userptr)
+{
+    pthread_mutex_unlock(&share_locks[data]);
+}
+
+static int transport_setup(void)
+{
+    if (curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK)
+    {
+        return 0;
+    }
+
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++)
+    {
+        pthread_mutex_init(&share_locks[i], NULL);
+    }
+
+    shared_handle = curl_share_init();
+    if (shared_handle == NULL)
+    {
+        for (int i = 0; i < CURL_LOCK_DATA_LAST; i++)
+        {
+            pthread_mutex_destroy(&share_locks[i]);
+        }
+        curl_global_cleanup();
+        return 0;
+    }
+
+    curl_share_setopt(shared_handle, CURLSHOPT_LOCKFUNC, share_lock);
+    curl_share_setopt(shared_handle, CURLSHOPT_UNLOCKFUNC, share_unlock);
+    curl_share_setopt(shared_handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(shared_handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(shared_handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+
+    atomic_store(&transport_ready, 1);
+    return 1;
+}
+
+static void transport_teardown(void)
+{
+    atomic_store(&transport_ready, 0);
+
+    pthread_mutex_lock(&pool_lock);
+    while (pool_count > 0)
+    {
+        curl_easy_cleanup(handle_pool[--pool_count]);
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    curl_share_cleanup(shared_handle);
+    shared_handle = NULL;
+
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++)
+    {
+        pthread_mutex_destroy(&share_locks[i]);
+    }
+
+    curl_global_cleanup();
+}
+
+// Every library that uses the transport takes a reference in JNI_OnLoad and
+// drops it in JNI_OnUnload; curl global state lives while any reference does.
+int transport_init(void)
+{
+    int ready = 1;
+
+    pthread_mutex_lock(&init_lock);
+    if (init_refs == 0)
+    {
+        ready = transport_setup();
+    }
+    if (ready)
+    {
+        init_refs++;
+    }
+    pthread_mutex_unlock(&init_lock);
+
+    return ready;
+}
+
+void transport_shutdown(void)
+{
+    pthread_mutex_lock(&init_lock);
+    if (init_refs > 0 && --init_refs == 0)
+    {
+        transport_teardown();
+    }
+    pthread_mutex_unlock(&init_lock);
+}
+
+static void apply_defaults(CURL *curl)
+{
+    curl_easy_setopt(curl, CURLOPT_SHARE, shared_handle);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, 300L);
+}
+
+CURL *transport_acquire(void)
+{
+    if (!atomic_load(&transport_ready))
+    {
+        return NULL;
+    }
+
+    CURL *curl = NULL;
+
+    pthread_mutex_lock(&pool_lock);
+    if (pool_count > 0)
+    {
+        curl = handle_pool[--pool_count];
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    if (curl != NULL)
+    {
+        atomic_fetch_add(&stat_handle_hits, 1);
+    }
+    else
+    {
+        curl = curl_easy_init();
+        if (curl == NULL)
+        {
+            return NULL;
+        }
+        atomic_fetch_add(&stat_handle_misses, 1);
+    }
+
+    apply_defaults(curl);
+    return curl;
+}
+
+void transport_release(CURL *curl)
+{
+    if (curl == NULL)
+    {
+        return;
+    }
+
+    curl_easy_reset(curl);
+
+    pthread_mutex_lock(&pool_lock);
+    if (pool_count < TRANSPORT_POOL_SIZE)
+    {
+        handle_pool[pool_count++] = curl;
+        curl = NULL;
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    if (curl != NULL)
+    {
+        curl_easy_cleanup(curl);
+    }
+}
+
+void transport_reset(CURL *curl)
+{
+    curl_easy_reset(curl);
+    apply_defaults(curl);
+}
+
+void transport_account(CURL *curl, CURLcode result)
+{
+    long new_connections = 0;
+    if (curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &new_connections) == CURLE_OK)
+    {
+        if (new_connections > 0)
+        {
+            atomic_fetch_add(&stat_connection_opens, new_connections);
+        }
+        else if (result == CURLE_OK)
+        {
+            atomic_fetch_add(&stat_connection_reuses, 1);
+        }
+    }
+}
+
+CURLcode transport_perform(CURL *curl)
+{
+    CURLcode res = curl_easy_perform(curl);
+    transport_account(curl, res);
+    return res;
+}
+
+void transport_get_stats(TransportStats *stats)
+{
+    stats->handle_hits = atomic_load(&stat_handle_hits);
+    stats->handle_misses = atomic_load(&stat_handle_misses);
+    stats->connection_reuses = atomic_load(&stat_connection_reuses);
+    stats->connection_opens = atomic_load(&stat_connection_opens);
+}
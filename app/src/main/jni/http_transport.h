@@ -0,0 +1,25 @@
+#ifndef HTTP_TRANSPORT_H
+#define HTTP_TRANSPORT_H
+
+#include <curl/curl.h>
+
+#define TRANSPORT_POOL_SIZE 4
+
+typedef struct
+{
+    long handle_hits;
+    long handle_misses;
+    long connection_reuses;
+    long connection_opens;
+} TransportStats;
+
+int transport_init(void);
+void transport_shutdown(void);
+CURL *transport_acquire(void);
+void transport_release(CURL *curl);
+void transport_reset(CURL *curl);
+CURLcode transport_perform(CURL *curl);
+void transport_account(CURL *curl, CURLcode result);
+void transport_get_stats(TransportStats *stats);
+
+#endif
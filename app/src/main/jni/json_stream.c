@@ -0,0 +1,557 @@
+#include <string.h>
+#include "json_stream.h"
+
+enum
+{
+    STATE_VALUE,
+    STATE_OBJECT_KEY,
+    STATE_STRING,
+    STATE_ESCAPE,
+    STATE_UNICODE,
+    STATE_LITERAL,
+    STATE_COLON,
+    STATE_AFTER_VALUE,
+    STATE_RAW,
+    STATE_END
+};
+
+static int is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static int in_object(const JsonStream *stream)
+{
+    return stream->depth > 0 && (stream->object_bits >> (stream->depth - 1)) & 1u;
+}
+
+static void append_byte(JsonStream *stream, unsigned char byte)
+{
+    if (stream->string_is_key)
+    {
+        if (stream->key_len < JSON_KEY_MAX - 1)
+        {
+            stream->key[stream->key_len++] = (char)byte;
+        }
+        else
+        {
+            stream->key_overflow = 1;
+        }
+        return;
+    }
+
+    JsonField *field = stream->capture;
+    if (field == NULL)
+    {
+        return;
+    }
+
+    if (field->len < JSON_VALUE_MAX - 1)
+    {
+        field->value[field->len++] = (char)byte;
+    }
+    else
+    {
+        field->overflow = 1;
+    }
+}
+
+static void append_code_point(JsonStream *stream, unsigned int cp)
+{
+    if (cp < 0x80)
+    {
+        append_byte(stream, (unsigned char)cp);
+    }
+    else if (cp < 0x800)
+    {
+        append_byte(stream, (unsigned char)(0xC0 | (cp >> 6)));
+        append_byte(stream, (unsigned char)(0x80 | (cp & 0x3F)));
+    }
+    else if (cp < 0x10000)
+    {
+        append_byte(stream, (unsigned char)(0xE0 | (cp >> 12)));
+        append_byte(stream, (unsigned char)(0x80 | ((cp >> 6) & 0x3F)));
+        append_byte(stream, (unsigned char)(0x80 | (cp & 0x3F)));
+    }
+    else
+    {
+        append_byte(stream, (unsigned char)(0xF0 | (cp >> 18)));
+        append_byte(stream, (unsigned char)(0x80 | ((cp >> 12) & 0x3F)));
+        append_byte(stream, (unsigned char)(0x80 | ((cp >> 6) & 0x3F)));
+        append_byte(stream, (unsigned char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+static void flush_surrogate(JsonStream *stream)
+{
+    if (stream->high_surrogate != 0)
+    {
+        append_code_point(stream, 0xFFFD);
+        stream->high_surrogate = 0;
+    }
+}
+
+static void complete_field(JsonStream *stream, JsonField *field)
+{
+    if (field == NULL || field->found)
+    {
+        return;
+    }
+
+    field->value[field->len] = '\0';
+    if (!field->overflow)
+    {
+        field->found = 1;
+        if (++stream->found_count == stream->field_count)
+        {
+            stream->status = JSON_DONE;
+        }
+    }
+}
+
+// Only members of the top-level object are matched.
+static JsonField *match_key(JsonStream *stream)
+{
+    if (stream->key_overflow || stream->depth != 1)
+    {
+        return NULL;
+    }
+
+    for (int i = 0; i < stream->field_count; i++)
+    {
+        JsonField *field = &stream->fields[i];
+        if (field->name != NULL && !field->found && strlen(field->name) == stream->key_len &&
+            memcmp(field->name, stream->key, stream->key_len) == 0)
+        {
+            return field;
+        }
+    }
+    return NULL;
+}
+
+static JsonField *root_field(JsonStream *stream)
+{
+    for (int i = 0; i < stream->field_count; i++)
+    {
+        if (stream->fields[i].name == NULL)
+        {
+            return &stream->fields[i];
+        }
+    }
+    return NULL;
+}
+
+static void fail(JsonStream *stream)
+{
+    stream->status = JSON_ERROR;
+    stream->state = STATE_END;
+}
+
+static void end_value(JsonStream *stream)
+{
+    stream->state = stream->depth == 0 ? STATE_END : STATE_AFTER_VALUE;
+}
+
+static int push(JsonStream *stream, int object)
+{
+    if (stream->depth >= JSON_DEPTH_MAX)
+    {
+        fail(stream);
+        return 0;
+    }
+
+    if (object)
+    {
+        stream->object_bits |= 1u << stream->depth;
+    }
+    else
+    {
+        stream->object_bits &= ~(1u << stream->depth);
+    }
+    stream->depth++;
+    return 1;
+}
+
+static void pop(JsonStream *stream, char close)
+{
+    if (stream->depth == 0 || (close == '}') != in_object(stream))
+    {
+        fail(stream);
+        return;
+    }
+
+    stream->depth--;
+    end_value(stream);
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+static void finish_unicode(JsonStream *stream)
+{
+    unsigned int unit = stream->unicode;
+
+    if (unit >= 0xD800 && unit <= 0xDBFF)
+    {
+        flush_surrogate(stream);
+        stream->high_surrogate = unit;
+    }
+    else if (unit >= 0xDC00 && unit <= 0xDFFF)
+    {
+        if (stream->high_surrogate != 0)
+        {
+            append_code_point(stream, 0x10000 + ((stream->high_surrogate - 0xD800) << 10) + (unit - 0xDC00));
+            stream->high_surrogate = 0;
+        }
+        else
+        {
+            append_code_point(stream, 0xFFFD);
+        }
+    }
+    else
+    {
+        flush_surrogate(stream);
+        append_code_point(stream, unit);
+    }
+
+    stream->state = STATE_STRING;
+}
+
+void json_stream_init(JsonStream *stream, JsonField *fields, int field_count)
+{
+    memset(stream, 0, sizeof(JsonStream));
+    stream->fields = fields;
+    stream->field_count = field_count;
+    stream->status = JSON_NEED_MORE;
+    stream->state = STATE_VALUE;
+
+    for (int i = 0; i < field_count; i++)
+    {
+        fields[i].len = 0;
+        fields[i].found = 0;
+        fields[i].overflow = 0;
+        fields[i].value[0] = '\0';
+    }
+}
+
+JsonStatus json_stream_feed(JsonStream *stream, const char *data, size_t len)
+{
+    size_t pos = 0;
+
+    while (pos < len && stream->status == JSON_NEED_MORE)
+    {
+        char c = data[pos];
+
+        switch (stream->state)
+        {
+        case STATE_VALUE:
+            if (is_space(c))
+            {
+                pos++;
+            }
+            else if (c == '"')
+            {
+                stream->string_is_key = 0;
+                stream->capture = stream->depth == 0 ? root_field(stream) : stream->pending;
+                stream->pending = NULL;
+                stream->state = STATE_STRING;
+                pos++;
+            }
+            else if (c == '{' || c == '[')
+            {
+                stream->pending = NULL;
+                if (push(stream, c == '{'))
+                {
+                    stream->state = c == '{' ? STATE_OBJECT_KEY : STATE_VALUE;
+                }
+                pos++;
+            }
+            else if (c == ']' && stream->depth > 0 && !in_object(stream))
+            {
+                pop(stream, c);
+                pos++;
+            }
+            else if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n')
+            {
+                stream->pending = NULL;
+                stream->state = STATE_LITERAL;
+            }
+            else if (stream->depth == 0 && root_field(stream) != NULL)
+            {
+                // Not JSON at all; keep the text as the root value.
+                stream->string_is_key = 0;
+                stream->capture = root_field(stream);
+                stream->state = STATE_RAW;
+            }
+            else
+            {
+                fail(stream);
+            }
+            break;
+
+        case STATE_OBJECT_KEY:
+            if (is_space(c))
+            {
+                pos++;
+            }
+            else if (c == '"')
+            {
+                stream->string_is_key = 1;
+                stream->key_len = 0;
+                stream->key_overflow = 0;
+                stream->state = STATE_STRING;
+                pos++;
+            }
+            else if (c == '}')
+            {
+                pop(stream, c);
+                pos++;
+            }
+            else
+            {
+                fail(stream);
+            }
+            break;
+
+        case STATE_STRING:
+            pos++;
+            if (c == '"')
+            {
+                flush_surrogate(stream);
+                if (stream->string_is_key)
+                {
+                    stream->pending = match_key(stream);
+                    stream->string_is_key = 0;
+                    stream->state = STATE_COLON;
+                }
+                else
+                {
+                    complete_field(stream, stream->capture);
+                    stream->capture = NULL;
+                    end_value(stream);
+                }
+            }
+            else if (c == '\\')
+            {
+                stream->state = STATE_ESCAPE;
+            }
+            else
+            {
+                flush_surrogate(stream);
+                append_byte(stream, (unsigned char)c);
+            }
+            break;
+
+        case STATE_ESCAPE:
+            pos++;
+            stream->state = STATE_STRING;
+            if (c == 'u')
+            {
+                stream->unicode = 0;
+                stream->unicode_digits = 0;
+                stream->state = STATE_UNICODE;
+                break;
+            }
+
+            flush_surrogate(stream);
+            switch (c)
+            {
+            case 'b':
+                append_byte(stream, '\b');
+                break;
+            case 'f':
+                append_byte(stream, '\f');
+                break;
+            case 'n':
+                append_byte(stream, '\n');
+                break;
+            case 'r':
+                append_byte(stream, '\r');
+                break;
+            case 't':
+                append_byte(stream, '\t');
+                break;
+            case '"':
+            case '\\':
+            case '/':
+                append_byte(stream, (unsigned char)c);
+                break;
+            default:
+                fail(stream);
+                break;
+            }
+            break;
+
+        case STATE_UNICODE:
+        {
+            int digit = hex_value(c);
+            pos++;
+            if (digit < 0)
+            {
+                fail(stream);
+                break;
+            }
+            stream->unicode = (stream->unicode << 4) | (unsigned int)digit;
+            if (++stream->unicode_digits == 4)
+            {
+                finish_unicode(stream);
+            }
+            break;
+        }
+
+        case STATE_LITERAL:
+            if (c == ',' || c == '}' || c == ']' || is_space(c))
+            {
+                end_value(stream);
+            }
+            else
+            {
+                pos++;
+            }
+            break;
+
+        case STATE_COLON:
+            if (is_space(c))
+            {
+                pos++;
+            }
+            else if (c == ':')
+            {
+                stream->state = STATE_VALUE;
+                pos++;
+            }
+            else
+            {
+                fail(stream);
+            }
+            break;
+
+        case STATE_AFTER_VALUE:
+            pos++;
+            if (is_space(c))
+            {
+                break;
+            }
+            if (c == ',')
+            {
+                stream->state = in_object(stream) ? STATE_OBJECT_KEY : STATE_VALUE;
+            }
+            else if (c == '}' || c == ']')
+            {
+                pop(stream, c);
+            }
+            else
+            {
+                fail(stream);
+            }
+            break;
+
+        case STATE_RAW:
+            append_byte(stream, (unsigned char)c);
+            pos++;
+            break;
+
+        case STATE_END:
+            // Trailing bytes after the root value are ignored.
+            pos = len;
+            break;
+        }
+    }
+
+    return stream->status;
+}
+
+JsonStatus json_stream_finish(JsonStream *stream)
+{
+    if (stream->status == JSON_NEED_MORE && stream->state == STATE_RAW && stream->capture != NULL)
+    {
+        JsonField *field = stream->capture;
+        while (field->len > 0 && is_space(field->value[field->len - 1]))
+        {
+            field->len--;
+        }
+        if (field->len > 0)
+        {
+            complete_field(stream, field);
+        }
+    }
+
+    if (stream->status == JSON_NEED_MORE)
+    {
+        stream->status = stream->found_count == stream->field_count ? JSON_DONE : JSON_ERROR;
+    }
+    return stream->status;
+}
+
+static size_t json_write_callback(void *contents, size_t size, size_t nmemb, void *userp)
+{
+    size_t realsize = size * nmemb;
+    JsonStream *stream = (JsonStream *)userp;
+
+    stream->bytes_seen += (curl_off_t)realsize;
+    if (stream->bytes_seen > JSON_BODY_MAX)
+    {
+        // Bodies without a Content-Length get past MAXFILESIZE; cap them
+        // here. Fields that were already complete are still good.
+        if (stream->status == JSON_DONE)
+        {
+            stream->stopped_early = 1;
+        }
+        else
+        {
+            fail(stream);
+        }
+        return 0;
+    }
+
+    if (stream->status == JSON_NEED_MORE)
+    {
+        if (json_stream_feed(stream, (const char *)contents, realsize) == JSON_DONE)
+        {
+            stream->done_at = stream->bytes_seen;
+        }
+    }
+
+    // Once every field is in, a short remainder is drained so the connection
+    // stays reusable; a long one is not worth receiving, so the transfer ends
+    // here. Without a Content-Length the drain gets a fixed budget.
+    if (stream->status == JSON_DONE)
+    {
+        curl_off_t length = -1;
+        curl_easy_getinfo(stream->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+        curl_off_t remaining = length >= 0 ? length - stream->bytes_seen
+                                           : stream->bytes_seen - stream->done_at;
+        if (remaining > JSON_DRAIN_MAX)
+        {
+            stream->stopped_early = 1;
+            return 0;
+        }
+    }
+
+    return realsize;
+}
+
+void json_stream_attach(JsonStream *stream, CURL *curl)
+{
+    stream->curl = curl;
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, json_write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)stream);
+    curl_easy_setopt(curl, CURLOPT_MAXFILESIZE_LARGE, (curl_off_t)JSON_BODY_MAX);
+}
+
+CURLcode json_stream_result(const JsonStream *stream, CURLcode res)
+{
+    if (res == CURLE_WRITE_ERROR && stream->stopped_early)
+    {
+        return CURLE_OK;
+    }
+    return res;
+}
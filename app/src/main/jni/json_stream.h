@@ -0,0 +1,64 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <curl/curl.h>
+
+#define JSON_VALUE_MAX 1024
+#define JSON_KEY_MAX 64
+#define JSON_DEPTH_MAX 32
+#define JSON_BODY_MAX (64 * 1024)
+#define JSON_DRAIN_MAX 4096
+
+typedef enum
+{
+    JSON_NEED_MORE,
+    JSON_DONE,
+    JSON_ERROR
+} JsonStatus;
+
+// A top-level string member to extract. A NULL name captures the root value when the
+// document is a bare JSON string (or, failing that, unquoted text).
+typedef struct
+{
+    const char *name;
+    char value[JSON_VALUE_MAX];
+    size_t len;
+    int found;
+    int overflow;
+} JsonField;
+
+// Incremental tokenizer that unescapes only the requested string fields into
+// caller-owned storage; nothing is allocated and the body is never buffered.
+typedef struct
+{
+    JsonField *fields;
+    int field_count;
+    int found_count;
+    JsonStatus status;
+    int state;
+    unsigned int depth;
+    uint32_t object_bits;
+    int string_is_key;
+    char key[JSON_KEY_MAX];
+    size_t key_len;
+    int key_overflow;
+    JsonField *pending;
+    JsonField *capture;
+    unsigned int unicode;
+    int unicode_digits;
+    unsigned int high_surrogate;
+    CURL *curl;
+    curl_off_t bytes_seen;
+    curl_off_t done_at;
+    int stopped_early;
+} JsonStream;
+
+void json_stream_init(JsonStream *stream, JsonField *fields, int field_count);
+JsonStatus json_stream_feed(JsonStream *stream, const char *data, size_t len);
+JsonStatus json_stream_finish(JsonStream *stream);
+void json_stream_attach(JsonStream *stream, CURL *curl);
+CURLcode json_stream_result(const JsonStream *stream, CURLcode res);
+
+#endif
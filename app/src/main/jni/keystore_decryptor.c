@@ -2,75 +2,37 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
 #include <openssl/evp.h>
 #include <openssl/aes.h>
-#include <openssl/bio.h>
-#include <openssl/buffer.h>
+#include "native_crypto.h"
+#include "protected_strings.h"
 
 char *base64_encode(const unsigned char *input, int length)
 {
-    BIO *bmem, *b64;
-    BUF_MEM *bptr;
-    char *buff;
-
-    b64 = BIO_new(BIO_f_base64());
-    BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL);
-    bmem = BIO_new(BIO_s_mem());
-    b64 = BIO_push(b64, bmem);
-    BIO_write(b64, input, length);
-    BIO_flush(b64);
-    BIO_get_mem_ptr(b64, &bptr);
-
-    buff = (char *)malloc(bptr->length + 1);
-    memcpy(buff, bptr->data, bptr->length);
-    buff[bptr->length] = 0;
-
-    BIO_free_all(b64);
-    return buff;
-}
-
-char *aes_decrypt(const unsigned char *ciphertext, int ciphertext_len,
-                  const unsigned char *key, const unsigned char *iv)
-{
-    EVP_CIPHER_CTX *ctx;
-    int len;
-    int plaintext_len;
-    unsigned char *plaintext = (unsigned char *)malloc(ciphertext_len);
-
-    if (!(ctx = EVP_CIPHER_CTX_new()))
+    size_t capacity = crypto_base64_encoded_length((size_t)length) + 1;
+    char *buff = (char *)malloc(capacity);
+    if (buff != NULL && crypto_base64_encode(input, (size_t)length, buff, capacity) < 0)
     {
-        free(plaintext);
-        return NULL;
-    }
-
-    if (1 != EVP_DecryptInit_ex(ctx, EVP_aes_128_cbc(), NULL, key, iv))
-    {
-        EVP_CIPHER_CTX_free(ctx);
-        free(plaintext);
-        return NULL;
+        free(buff);
+        buff = NULL;
     }
+    return buff;
+}
 
-    if (1 != EVP_DecryptUpdate(ctx, plaintext, &len, ciphertext, ciphertext_len))
-    {
-        EVP_CIPHER_CTX_free(ctx);
-        free(plaintext);
-        return NULL;
-    }
-    plaintext_len = len;
+// The second fragment is a constant, so it is decrypted once (alongside the
+// message when that comes first) and served from here afterwards.
+static _Atomic(char *) second_fragment;
 
-    if (1 != EVP_DecryptFinal_ex(ctx, plaintext + len, &len))
+static void publish_second_fragment(const char *value)
+{
+    char *copy = value != NULL ? strdup(value) : NULL;
+    char *expected = NULL;
+    if (copy != NULL && !atomic_compare_exchange_strong(&second_fragment, &expected, copy))
     {
-        EVP_CIPHER_CTX_free(ctx);
-        free(plaintext);
-        return NULL;
+        free(copy);
     }
-    plaintext_len += len;
-
-    EVP_CIPHER_CTX_free(ctx);
-
-    plaintext[plaintext_len] = '\0';
-
-    return (char *)plaintext;
 }
 
 jstring Java_com_example_playground_network_NativeDecryptor_decryptMessage(
@@ -112,70 +74,48 @@ jstring Java_com_example_playground_network_NativeDecryptor_decryptMessage(
 
     (*env)->ReleaseStringUTFChars(env, thirdKeyJString, thirdKeyStr);
 
-    unsigned char iv[16];
-    memset(iv, '0', 16);
-
-    const char *encryptedBase64 = "8jPsLCgYQ26vNAXtBTEj3Q==";
-
-    BIO *b64, *bmem;
-    b64 = BIO_new(BIO_f_base64());
-    BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL);
-    bmem = BIO_new_mem_buf(encryptedBase64, -1);
-    bmem = BIO_push(b64, bmem);
+    CryptoBatchEntry entries[] = {
+        {protected_string(PS_MESSAGE_CIPHERTEXT), aesKey,
+         (const unsigned char *)protected_string(PS_MESSAGE_IV), CRYPTO_AES_128_CBC_BASE64},
+        {protected_string(PS_SECOND_CIPHERTEXT), (const unsigned char *)protected_string(PS_SECOND_KEY),
+         (const unsigned char *)protected_string(PS_SECOND_IV), CRYPTO_AES_128_CBC_BASE64},
+    };
+    const char *outputs[2];
+    size_t count = atomic_load(&second_fragment) == NULL ? 2 : 1;
 
-    unsigned char encrypted[1024] = {0};
-    int encryptedLen = BIO_read(bmem, encrypted, sizeof(encrypted));
-    BIO_free_all(bmem);
-
-    if (encryptedLen <= 0)
+    char *arena = crypto_decrypt_batch(entries, count, outputs);
+    if (arena == NULL)
     {
         return NULL;
     }
 
-    char *decrypted = aes_decrypt(encrypted, encryptedLen, aesKey, iv);
-    if (decrypted == NULL)
+    if (count == 2)
     {
-        return NULL;
+        publish_second_fragment(outputs[1]);
     }
 
-    jstring result = (*env)->NewStringUTF(env, decrypted);
+    jstring result = outputs[0] != NULL ? (*env)->NewStringUTF(env, outputs[0]) : NULL;
 
-    free(decrypted);
+    free(arena);
 
     return result;
 }
 
 char *decrypt_second_fragment()
 {
-    const unsigned char key[] = "aieIIiottweninfo";
-
-    unsigned char iv[16];
-    memset(iv, '1', 16);
-
-    const char *encryptedBase64 = "qGRv/ZNXAKL8L1XOwBTpI+J/opXZC+WtvRAMvqFb4fs=";
-
-    BIO *b64, *bmem;
-    b64 = BIO_new(BIO_f_base64());
-    BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL);
-    bmem = BIO_new_mem_buf(encryptedBase64, -1);
-    bmem = BIO_push(b64, bmem);
-
-    unsigned char encrypted[1024] = {0};
-    int encryptedLen = BIO_read(bmem, encrypted, sizeof(encrypted));
-    BIO_free_all(bmem);
-
-    if (encryptedLen <= 0)
+    char *cached = atomic_load(&second_fragment);
+    if (cached == NULL)
     {
-        return NULL;
+        char *decrypted = crypto_decrypt_base64(
+            protected_string(PS_SECOND_CIPHERTEXT),
+            (const unsigned char *)protected_string(PS_SECOND_KEY),
+            (const unsigned char *)protected_string(PS_SECOND_IV));
+        publish_second_fragment(decrypted);
+        free(decrypted);
+        cached = atomic_load(&second_fragment);
     }
 
-    char *decrypted = aes_decrypt(encrypted, encryptedLen, key, iv);
-    if (decrypted == NULL)
-    {
-        return NULL;
-    }
-
-    return decrypted;
+    return cached != NULL ? strdup(cached) : NULL;
 }
 
 JNIEXPORT jstring JNICALL Java_com_example_playground_network_NativeDecryptor_decryptSecondFragment(
@@ -195,54 +135,44 @@ JNIEXPORT jstring JNICALL Java_com_example_playground_network_NativeDecryptor_de
     return result;
 }
 
-char *decrypt_fifth_fragment()
-{
-    const char *encrypted_hex = "545C03585254045D520C5306070D565800535B565059060405075457000050535B025D0B5106015E";
-
-    const char *key1 = "4a17f315edc7aa28b1938eaf32d569da85ce14ab";
-    const char *key2 = "f6c8d74b78bd12c5a14df0b4dff7a79b271cc215";
-    const char *key3 = "b35fe102c4da1fb12e749830d5cbe79a4494f2e0";
+static pthread_once_t fifth_keystream_once = PTHREAD_ONCE_INIT;
+static XorKeystream fifth_keystream;
 
-    size_t encrypted_len = strlen(encrypted_hex) / 2;
+static void init_fifth_keystream(void)
+{
+    const char *keys[] = {
+        protected_string(PS_FIFTH_KEY_1),
+        protected_string(PS_FIFTH_KEY_2),
+        protected_string(PS_FIFTH_KEY_3),
+    };
+    crypto_xor_keystream_init(&fifth_keystream, keys, sizeof(keys) / sizeof(keys[0]));
+}
 
-    unsigned char *encrypted_data = (unsigned char *)malloc(encrypted_len);
-    if (!encrypted_data)
+char *decrypt_fifth_fragment()
+{
+    pthread_once(&fifth_keystream_once, init_fifth_keystream);
+    if (fifth_keystream.stream == NULL)
     {
         return NULL;
     }
 
-    for (size_t i = 0; i < encrypted_len; i++)
-    {
-        sscanf(&encrypted_hex[i * 2], "%2hhx", &encrypted_data[i]);
-    }
-
-    unsigned char *result = (unsigned char *)malloc(encrypted_len + 1);
+    const char *ciphertext_hex = protected_string(PS_FIFTH_CIPHERTEXT_HEX);
+    size_t hex_len = strlen(ciphertext_hex);
+    unsigned char *result = (unsigned char *)malloc(hex_len / 2 + 1);
     if (!result)
     {
-        free(encrypted_data);
         return NULL;
     }
 
-    memcpy(result, encrypted_data, encrypted_len);
-
-    for (size_t i = 0; i < encrypted_len; i++)
-    {
-        result[i] ^= key3[i % strlen(key3)];
-    }
-
-    for (size_t i = 0; i < encrypted_len; i++)
-    {
-        result[i] ^= key2[i % strlen(key2)];
-    }
-
-    for (size_t i = 0; i < encrypted_len; i++)
+    int len = crypto_hex_decode(ciphertext_hex, hex_len, result, hex_len / 2);
+    if (len < 0)
     {
-        result[i] ^= key1[i % strlen(key1)];
+        free(result);
+        return NULL;
     }
 
-    result[encrypted_len] = '\0';
-
-    free(encrypted_data);
+    crypto_xor_apply(&fifth_keystream, result, (size_t)len);
+    result[len] = '\0';
 
     return (char *)result;
-}
\ No newline at end of file
+}
@@ -0,0 +1,197 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/evp.h>
+#include "native_crypto.h"
+
+#define CRYPTO_THREAD_SLOTS 4
+
+// Each thread keeps a few cipher contexts keyed by the AES key they were set
+// up with. The fragment keys never change, so the common case re-arms an
+// existing context with a new IV and keeps its expanded key schedule.
+typedef struct
+{
+    EVP_CIPHER_CTX *ctx;
+    unsigned char key[CRYPTO_KEY_LEN];
+    int keyed;
+} CipherSlot;
+
+typedef struct
+{
+    CipherSlot slots[CRYPTO_THREAD_SLOTS];
+    int next_victim;
+} ThreadCiphers;
+
+static pthread_once_t ciphers_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ciphers_key;
+
+static void free_thread_ciphers(void *value)
+{
+    ThreadCiphers *ciphers = (ThreadCiphers *)value;
+    for (int i = 0; i < CRYPTO_THREAD_SLOTS; i++)
+    {
+        EVP_CIPHER_CTX_free(ciphers->slots[i].ctx);
+    }
+    free(ciphers);
+}
+
+static void create_ciphers_key(void)
+{
+    pthread_key_create(&ciphers_key, free_thread_ciphers);
+}
+
+static ThreadCiphers *thread_ciphers(void)
+{
+    pthread_once(&ciphers_once, create_ciphers_key);
+
+    ThreadCiphers *ciphers = (ThreadCiphers *)pthread_getspecific(ciphers_key);
+    if (ciphers == NULL)
+    {
+        ciphers = (ThreadCiphers *)calloc(1, sizeof(ThreadCiphers));
+        if (ciphers == NULL || pthread_setspecific(ciphers_key, ciphers) != 0)
+        {
+            free(ciphers);
+            return NULL;
+        }
+    }
+    return ciphers;
+}
+
+// Returns a context ready to decrypt with key and iv.
+static EVP_CIPHER_CTX *keyed_context(const unsigned char *key, const unsigned char *iv)
+{
+    ThreadCiphers *ciphers = thread_ciphers();
+    if (ciphers == NULL)
+    {
+        return NULL;
+    }
+
+    for (int i = 0; i < CRYPTO_THREAD_SLOTS; i++)
+    {
+        CipherSlot *slot = &ciphers->slots[i];
+        if (slot->keyed && memcmp(slot->key, key, CRYPTO_KEY_LEN) == 0)
+        {
+            if (EVP_DecryptInit_ex(slot->ctx, NULL, NULL, NULL, iv) == 1)
+            {
+                return slot->ctx;
+            }
+            slot->keyed = 0;
+            return NULL;
+        }
+    }
+
+    CipherSlot *slot = &ciphers->slots[ciphers->next_victim];
+    ciphers->next_victim = (ciphers->next_victim + 1) % CRYPTO_THREAD_SLOTS;
+
+    if (slot->ctx == NULL)
+    {
+        slot->ctx = EVP_CIPHER_CTX_new();
+        if (slot->ctx == NULL)
+        {
+            return NULL;
+        }
+    }
+    else
+    {
+        EVP_CIPHER_CTX_reset(slot->ctx);
+    }
+
+    slot->keyed = 0;
+    if (EVP_DecryptInit_ex(slot->ctx, EVP_aes_128_cbc(), NULL, key, iv) != 1)
+    {
+        return NULL;
+    }
+
+    memcpy(slot->key, key, CRYPTO_KEY_LEN);
+    slot->keyed = 1;
+    return slot->ctx;
+}
+
+int crypto_aes_decrypt(const unsigned char *ciphertext, size_t ciphertext_len, const unsigned char *key,
+                       const unsigned char *iv, unsigned char *out, size_t out_cap)
+{
+    if (ciphertext_len == 0 || ciphertext_len > INT32_MAX || out_cap < ciphertext_len + 1)
+    {
+        return -1;
+    }
+
+    EVP_CIPHER_CTX *ctx = keyed_context(key, iv);
+    if (ctx == NULL)
+    {
+        return -1;
+    }
+
+    int len = 0;
+    int final_len = 0;
+    if (EVP_DecryptUpdate(ctx, out, &len, ciphertext, (int)ciphertext_len) != 1 ||
+        EVP_DecryptFinal_ex(ctx, out + len, &final_len) != 1)
+    {
+        return -1;
+    }
+
+    out[len + final_len] = '\0';
+    return len + final_len;
+}
+
+// Room for the decoded bytes plus a terminator. Rounding the length up keeps
+// unpadded base64 (a partial final quantum) from overrunning the slot.
+static size_t slot_size(size_t base64_len)
+{
+    return (base64_len + 3) / 4 * 3 + 1;
+}
+
+char *crypto_decrypt_batch(const CryptoBatchEntry *entries, size_t count, const char **outputs)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        total += slot_size(strlen(entries[i].ciphertext));
+    }
+
+    char *arena = (char *)malloc(total > 0 ? total : 1);
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+
+    // Each slot receives the decoded ciphertext and is then decrypted in
+    // place; the plaintext is never longer than the ciphertext.
+    size_t offset = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        unsigned char *slot = (unsigned char *)arena + offset;
+        size_t length = strlen(entries[i].ciphertext);
+        size_t cap = slot_size(length);
+        offset += cap;
+        outputs[i] = NULL;
+
+        if (entries[i].mode != CRYPTO_AES_128_CBC_BASE64)
+        {
+            continue;
+        }
+
+        int decoded = crypto_base64_decode(entries[i].ciphertext, length, slot, cap);
+        if (decoded > 0 &&
+            crypto_aes_decrypt(slot, (size_t)decoded, entries[i].key, entries[i].iv, slot, cap) >= 0)
+        {
+            outputs[i] = (const char *)slot;
+        }
+    }
+
+    return arena;
+}
+
+char *crypto_decrypt_base64(const char *ciphertext_base64, const unsigned char *key, const unsigned char *iv)
+{
+    CryptoBatchEntry entry = {ciphertext_base64, key, iv, CRYPTO_AES_128_CBC_BASE64};
+    const char *plaintext = NULL;
+
+    char *arena = crypto_decrypt_batch(&entry, 1, &plaintext);
+    if (plaintext == NULL)
+    {
+        free(arena);
+        return NULL;
+    }
+    return arena;
+}
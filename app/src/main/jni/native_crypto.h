@@ -0,0 +1,69 @@
+#ifndef NATIVE_CRYPTO_H
+#define NATIVE_CRYPTO_H
+
+#include <stddef.h>
+
+#define CRYPTO_KEY_LEN 16
+#define CRYPTO_IV_LEN 16
+
+// AES-128-CBC with PKCS#7 padding. Writes the plaintext plus a terminating
+// NUL into out, which must hold at least ciphertext_len + 1 bytes. Returns the
+// plaintext length, or -1 on failure.
+int crypto_aes_decrypt(const unsigned char *ciphertext, size_t ciphertext_len, const unsigned char *key,
+                       const unsigned char *iv, unsigned char *out, size_t out_cap);
+
+// Decodes base64 (padded or not, no whitespace) into out and returns the
+// decoded length, or -1 when the input is malformed or out is too small.
+// Whole blocks go through SSSE3 or NEON when the CPU has them.
+int crypto_base64_decode(const char *input, size_t input_len, unsigned char *out, size_t out_cap);
+
+// Encodes with padding and a terminating NUL; out must hold
+// crypto_base64_encoded_length(input_len) + 1 bytes. Returns the encoded
+// length, or -1.
+size_t crypto_base64_encoded_length(size_t len);
+int crypto_base64_encode(const unsigned char *input, size_t input_len, char *out, size_t out_cap);
+
+// Base64 ciphertext in, heap NUL-terminated plaintext out (or NULL).
+char *crypto_decrypt_base64(const char *ciphertext_base64, const unsigned char *key, const unsigned char *iv);
+
+typedef enum
+{
+    CRYPTO_AES_128_CBC_BASE64
+} CryptoMode;
+
+typedef struct
+{
+    const char *ciphertext;
+    const unsigned char *key;
+    const unsigned char *iv;
+    CryptoMode mode;
+} CryptoBatchEntry;
+
+// Decrypts every entry into one arena. outputs[i] points at entry i's
+// NUL-terminated plaintext inside the arena, or is NULL if that entry failed.
+// Returns the arena, released with a single free(); NULL if it could not be
+// allocated.
+char *crypto_decrypt_batch(const CryptoBatchEntry *entries, size_t count, const char **outputs);
+
+#define XOR_KEYSTREAM_MAX 4096
+
+// Layered repeating-key XOR folded into a single keystream. Its length is
+// the lcm of the key lengths (rounded up to whole 16-byte lanes), so applying
+// every layer costs one pass with no per-byte modulo.
+typedef struct
+{
+    unsigned char *stream;
+    size_t len;
+} XorKeystream;
+
+// Returns 0 on success, -1 if a key is empty or the folded stream would
+// exceed XOR_KEYSTREAM_MAX.
+int crypto_xor_keystream_init(XorKeystream *keystream, const char *const *keys, size_t count);
+void crypto_xor_keystream_free(XorKeystream *keystream);
+void crypto_xor_apply(const XorKeystream *keystream, unsigned char *data, size_t len);
+
+// Table-driven hex decode (either case). Returns the byte count, or -1 on an
+// odd length, a non-hex digit, or a short buffer.
+int crypto_hex_decode(const char *hex, size_t hex_len, unsigned char *out, size_t out_cap);
+
+#endif
@@ -0,0 +1,175 @@
+# Obfuscates the NAME=value definitions in INPUT under a fresh random key and
+# writes two headers to OUTPUT_DIR:
+#   protected_string_ids.h   enum of PS_<NAME> ids, for every library
+#   protected_string_data.h  key, masked data and offsets, for protected_strings.c
+#
+# Each string is XORed with its own keystream: an xorshift32 generator seeded
+# from the key and the string's id, mixed with the key bytes. A prefix shared
+# between strings (every URL starts alike) therefore does not expose the key
+# the way a single repeating key would. The key ships in the same binary, so
+# this keeps the constants out of `strings` and casual inspection; it is not
+# encryption.
+#
+#   cmake -DINPUT=<file> -DOUTPUT_DIR=<dir> -P protect_strings.cmake
+#
+# Only commands available in CMake 3.10 are used; the input is read as hex so
+# values may contain any character, including ';' and '='.
+
+cmake_policy(SET CMP0054 NEW)
+
+set(HEX_DIGITS "0123456789abcdef")
+
+function(hex_byte_value hex out)
+    string(SUBSTRING "${hex}" 0 1 high)
+    string(SUBSTRING "${hex}" 1 1 low)
+    string(FIND "${HEX_DIGITS}" "${high}" high_value)
+    string(FIND "${HEX_DIGITS}" "${low}" low_value)
+    math(EXPR value "${high_value} * 16 + ${low_value}")
+    set(${out} ${value} PARENT_SCOPE)
+endfunction()
+
+file(READ "${INPUT}" content HEX)
+string(TOLOWER "${content}" content)
+string(LENGTH "${content}" content_len)
+
+string(RANDOM LENGTH 32 ALPHABET "${HEX_DIGITS}" key_hex)
+set(key_values "")
+foreach(i RANGE 0 15)
+    math(EXPR pos "${i} * 2")
+    string(SUBSTRING "${key_hex}" ${pos} 2 byte)
+    hex_byte_value(${byte} key_byte)
+    list(APPEND key_values ${key_byte})
+endforeach()
+
+set(key_words "")
+foreach(i RANGE 0 3)
+    math(EXPR base "${i} * 4")
+    set(word 0)
+    foreach(j RANGE 0 3)
+        math(EXPR index "${base} + 3 - ${j}")
+        list(GET key_values ${index} key_byte)
+        math(EXPR word "(${word} << 8) | ${key_byte}")
+    endforeach()
+    list(APPEND key_words ${word})
+endforeach()
+
+# Must match start_keystream() and next_keystream() in protected_strings.c.
+macro(start_keystream id)
+    math(EXPR word_index "${id} % 4")
+    list(GET key_words ${word_index} word)
+    math(EXPR stream_state "(${word} ^ ((${id} + 1) * 2654435761)) & 4294967295")
+    if(stream_state EQUAL 0)
+        set(stream_state 1)
+    endif()
+    set(stream_id ${id})
+    set(stream_pos 0)
+endmacro()
+
+macro(next_keystream out)
+    math(EXPR stream_state "(${stream_state} ^ (${stream_state} << 13)) & 4294967295")
+    math(EXPR stream_state "${stream_state} ^ (${stream_state} >> 17)")
+    math(EXPR stream_state "(${stream_state} ^ (${stream_state} << 5)) & 4294967295")
+    math(EXPR key_index "(${stream_pos} + ${stream_id}) % 16")
+    list(GET key_values ${key_index} key_byte)
+    math(EXPR ${out} "(${stream_state} >> 24) ^ ${key_byte}")
+    math(EXPR stream_pos "${stream_pos} + 1")
+endmacro()
+
+set(names "")
+set(name_count 0)
+set(data "")
+set(offsets "")
+set(offset 0)
+
+# Walk the file byte by byte: 0x0a ends a line, 0x23 ('#') at the start of a
+# line comments it out, the first 0x3d ('=') splits name from value.
+set(line_start TRUE)
+set(mode "NAME")
+set(name "")
+set(pos 0)
+while(pos LESS content_len)
+    string(SUBSTRING "${content}" ${pos} 2 byte)
+    math(EXPR pos "${pos} + 2")
+
+    if(byte STREQUAL "0a")
+        if(mode STREQUAL "VALUE")
+            list(APPEND names ${name})
+            math(EXPR name_count "${name_count} + 1")
+            # Terminating NUL, masked like the rest.
+            next_keystream(mask)
+            list(APPEND data ${mask})
+            math(EXPR offset "${offset} + 1")
+        endif()
+        set(line_start TRUE)
+        set(mode "NAME")
+        set(name "")
+    elseif(byte STREQUAL "0d")
+        # Tolerate CRLF files.
+    elseif(mode STREQUAL "COMMENT")
+    elseif(line_start AND byte STREQUAL "23")
+        set(mode "COMMENT")
+    elseif(mode STREQUAL "NAME")
+        set(line_start FALSE)
+        if(byte STREQUAL "3d")
+            if(name STREQUAL "")
+                message(FATAL_ERROR "${INPUT}: definition without a name")
+            endif()
+            set(mode "VALUE")
+            list(APPEND offsets ${offset})
+            start_keystream(${name_count})
+        else()
+            hex_byte_value(${byte} char)
+            string(ASCII ${char} char)
+            set(name "${name}${char}")
+        endif()
+    else()
+        hex_byte_value(${byte} plain)
+        next_keystream(mask)
+        math(EXPR masked "${plain} ^ ${mask}")
+        list(APPEND data ${masked})
+        math(EXPR offset "${offset} + 1")
+    endif()
+endwhile()
+
+if(mode STREQUAL "VALUE")
+    message(FATAL_ERROR "${INPUT}: the last definition must end with a newline")
+endif()
+
+string(REPLACE ";" ", " key_text "${key_values}")
+string(REPLACE ";" ", " data_text "${data}")
+string(REPLACE ";" ", " offsets_text "${offsets}")
+
+set(ids_text "")
+foreach(name ${names})
+    set(ids_text "${ids_text}    PS_${name},\n")
+endforeach()
+
+set(ids_header
+"/* Generated by protect_strings.cmake; edit protected_strings.txt instead. */
+#ifndef PROTECTED_STRING_IDS_H
+#define PROTECTED_STRING_IDS_H
+
+typedef enum
+{
+${ids_text}    PS_COUNT
+} ProtectedStringId;
+
+#endif
+")
+
+# The ids only change when definitions are added or removed; leaving the file
+# untouched otherwise keeps the consumers from recompiling on a key rotation.
+set(existing_ids "")
+if(EXISTS "${OUTPUT_DIR}/protected_string_ids.h")
+    file(READ "${OUTPUT_DIR}/protected_string_ids.h" existing_ids)
+endif()
+if(NOT existing_ids STREQUAL ids_header)
+    file(WRITE "${OUTPUT_DIR}/protected_string_ids.h" "${ids_header}")
+endif()
+
+file(WRITE "${OUTPUT_DIR}/protected_string_data.h"
+"/* Generated by protect_strings.cmake; edit protected_strings.txt instead. */
+static const unsigned char PROTECTED_KEY[16] = {${key_text}};
+static const unsigned char PROTECTED_DATA[] = {${data_text}};
+static const unsigned int PROTECTED_OFFSETS[] = {${offsets_text}};
+")
@@ -0,0 +1,110 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "protected_strings.h"
+#include "protected_string_data.h"
+
+_Static_assert(sizeof(PROTECTED_OFFSETS) / sizeof(PROTECTED_OFFSETS[0]) == PS_COUNT,
+               "protected_string_data.h is out of date");
+
+static pthread_once_t decode_once = PTHREAD_ONCE_INIT;
+static const char *decoded[PS_COUNT];
+
+static unsigned char *allocate_cache(size_t size, size_t *mapped)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    *mapped = page > 0 ? (size + (size_t)page - 1) / (size_t)page * (size_t)page : 0;
+
+    if (*mapped > 0)
+    {
+        void *region = mmap(NULL, *mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (region != MAP_FAILED)
+        {
+#ifdef MADV_DONTDUMP
+            madvise(region, *mapped, MADV_DONTDUMP);
+#endif
+            return (unsigned char *)region;
+        }
+    }
+
+    *mapped = 0;
+    return (unsigned char *)malloc(size);
+}
+
+typedef struct
+{
+    uint32_t state;
+    unsigned int id;
+    unsigned int pos;
+} Keystream;
+
+// Must match start_keystream and next_keystream in protect_strings.cmake.
+static void start_keystream(Keystream *stream, unsigned int id)
+{
+    const unsigned char *word = PROTECTED_KEY + (id % 4) * 4;
+    uint32_t key_word = (uint32_t)word[0] | (uint32_t)word[1] << 8 | (uint32_t)word[2] << 16 |
+                        (uint32_t)word[3] << 24;
+
+    stream->state = key_word ^ (uint32_t)((id + 1) * 2654435761u);
+    if (stream->state == 0)
+    {
+        stream->state = 1;
+    }
+    stream->id = id;
+    stream->pos = 0;
+}
+
+static unsigned char next_keystream(Keystream *stream)
+{
+    uint32_t x = stream->state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    stream->state = x;
+
+    unsigned char key_byte = PROTECTED_KEY[(stream->pos + stream->id) % sizeof(PROTECTED_KEY)];
+    stream->pos++;
+    return (unsigned char)(x >> 24) ^ key_byte;
+}
+
+// All constants are unmasked together into their own mapping, which is then
+// made read-only and kept out of core dumps.
+static void decode_all(void)
+{
+    size_t mapped = 0;
+    unsigned char *cache = allocate_cache(sizeof(PROTECTED_DATA), &mapped);
+    if (cache == NULL)
+    {
+        return;
+    }
+
+    // Strings are laid out in id order, each running up to the next offset.
+    for (unsigned int id = 0; id < PS_COUNT; id++)
+    {
+        size_t end = id + 1 < PS_COUNT ? PROTECTED_OFFSETS[id + 1] : sizeof(PROTECTED_DATA);
+        Keystream stream;
+        start_keystream(&stream, id);
+        for (size_t i = PROTECTED_OFFSETS[id]; i < end; i++)
+        {
+            cache[i] = PROTECTED_DATA[i] ^ next_keystream(&stream);
+        }
+    }
+
+    if (mapped > 0)
+    {
+        mprotect(cache, mapped, PROT_READ);
+    }
+
+    for (int id = 0; id < PS_COUNT; id++)
+    {
+        decoded[id] = (const char *)cache + PROTECTED_OFFSETS[id];
+    }
+}
+
+const char *protected_string(ProtectedStringId id)
+{
+    pthread_once(&decode_once, decode_all);
+    return (unsigned int)id < PS_COUNT ? decoded[id] : NULL;
+}
@@ -0,0 +1,10 @@
+#ifndef PROTECTED_STRINGS_H
+#define PROTECTED_STRINGS_H
+
+#include "protected_string_ids.h"
+
+// Returns the plain constant for id. Every constant is unmasked on the first
+// call into a read-only cache; later calls are a table lookup.
+const char *protected_string(ProtectedStringId id);
+
+#endif
@@ -0,0 +1,409 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include "signature_manager.h"
+#include "http_engine.h"
+#include "http_transport.h"
+#include "cert_pinning.h"
+#include "json_stream.h"
+#include "protected_strings.h"
+
+typedef struct
+{
+    char *value;
+    long long expires_ms;
+} PooledSignature;
+
+typedef struct
+{
+    JsonField signature;
+    JsonStream stream;
+} AuthResponse;
+
+typedef struct
+{
+    AuthResponse response;
+    struct curl_slist *headers;
+    char *auth_header;
+    SignatureCallback callback;
+    void *userdata;
+} AuthFetch;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static PooledSignature pool[SIGNATURE_POOL_MAX];
+static int pool_count = 0;
+static int pool_target = SIGNATURE_DEFAULT_POOL_SIZE;
+static long ttl_ms = SIGNATURE_DEFAULT_TTL_MS;
+static int refills_pending = 0;
+
+static atomic_long stat_hits;
+static atomic_long stat_misses;
+static atomic_long stat_refreshes;
+static atomic_long stat_rejections;
+
+// The /auth body is parsed as it arrives; only the signature value is kept.
+static char *take_signature(const AuthResponse *response, CURLcode result)
+{
+    if (json_stream_result(&response->stream, result) != CURLE_OK || !response->signature.found ||
+        response->signature.len == 0)
+    {
+        return NULL;
+    }
+
+    return strdup(response->signature.value);
+}
+
+static void pool_remove(int index)
+{
+    free(pool[index].value);
+    pool[index] = pool[--pool_count];
+}
+
+// Caller holds pool_lock.
+static void pool_purge(long long now)
+{
+    for (int i = pool_count - 1; i >= 0; i--)
+    {
+        if (pool[i].expires_ms <= now)
+        {
+            pool_remove(i);
+        }
+    }
+}
+
+static void pool_store(const char *signature)
+{
+    char *copy = strdup(signature);
+    if (copy == NULL)
+    {
+        return;
+    }
+
+    long long now = monotonic_ms();
+
+    pthread_mutex_lock(&pool_lock);
+    pool_purge(now);
+
+    if (pool_target <= 0)
+    {
+        free(copy);
+    }
+    else
+    {
+        if (pool_count >= pool_target || pool_count >= SIGNATURE_POOL_MAX)
+        {
+            int oldest = 0;
+            for (int i = 1; i < pool_count; i++)
+            {
+                if (pool[i].expires_ms < pool[oldest].expires_ms)
+                {
+                    oldest = i;
+                }
+            }
+            pool_remove(oldest);
+        }
+
+        pool[pool_count].value = copy;
+        pool[pool_count].expires_ms = now + ttl_ms;
+        pool_count++;
+    }
+
+    pthread_mutex_unlock(&pool_lock);
+}
+
+static char *pool_take(void)
+{
+    char *signature = NULL;
+    long long now = monotonic_ms();
+
+    pthread_mutex_lock(&pool_lock);
+    pool_purge(now);
+
+    int freshest = -1;
+    for (int i = 0; i < pool_count; i++)
+    {
+        if (freshest < 0 || pool[i].expires_ms > pool[freshest].expires_ms)
+        {
+            freshest = i;
+        }
+    }
+
+    if (freshest >= 0)
+    {
+        signature = strdup(pool[freshest].value);
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    return signature;
+}
+
+static struct curl_slist *prepare_auth_request(CURL *curl, const char *auth_header, AuthResponse *response)
+{
+    curl_easy_setopt(curl, CURLOPT_URL, protected_string(PS_SERVICE_AUTH_URL));
+
+    pinning_apply(curl);
+
+    struct curl_slist *headers = NULL;
+    headers = curl_slist_append(headers, auth_header);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, 0L);
+
+    response->signature.name = "signature";
+    json_stream_init(&response->stream, &response->signature, 1);
+    json_stream_attach(&response->stream, curl);
+
+    return headers;
+}
+
+static void free_fetch(AuthFetch *fetch)
+{
+    curl_slist_free_all(fetch->headers);
+    free(fetch->auth_header);
+    free(fetch);
+}
+
+static AuthFetch *new_fetch(CURL *curl, const char *auth_header, SignatureCallback callback, void *userdata)
+{
+    AuthFetch *fetch = (AuthFetch *)calloc(1, sizeof(AuthFetch));
+    if (fetch == NULL)
+    {
+        return NULL;
+    }
+
+    fetch->auth_header = strdup(auth_header);
+    if (fetch->auth_header == NULL)
+    {
+        free_fetch(fetch);
+        return NULL;
+    }
+    fetch->callback = callback;
+    fetch->userdata = userdata;
+    fetch->headers = prepare_auth_request(curl, fetch->auth_header, &fetch->response);
+
+    return fetch;
+}
+
+static void on_refill_done(CURL *curl, CURLcode result, void *userdata)
+{
+    AuthFetch *fetch = (AuthFetch *)userdata;
+
+    char *signature = take_signature(&fetch->response, result);
+    if (signature != NULL)
+    {
+        pool_store(signature);
+        atomic_fetch_add(&stat_refreshes, 1);
+        free(signature);
+    }
+
+    pthread_mutex_lock(&pool_lock);
+    refills_pending--;
+    pthread_mutex_unlock(&pool_lock);
+
+    transport_release(curl);
+    free_fetch(fetch);
+}
+
+void signature_prefetch(const char *auth_header)
+{
+    long long now = monotonic_ms();
+
+    pthread_mutex_lock(&pool_lock);
+    pool_purge(now);
+
+    int needed = pool_target - pool_count - refills_pending;
+
+    // Refresh ahead of expiry so a hit never has to wait for a new /auth.
+    if (needed <= 0 && refills_pending == 0 && pool_count > 0)
+    {
+        long long freshest = 0;
+        for (int i = 0; i < pool_count; i++)
+        {
+            if (pool[i].expires_ms > freshest)
+            {
+                freshest = pool[i].expires_ms;
+            }
+        }
+        if (freshest - now < ttl_ms / 5)
+        {
+            needed = 1;
+        }
+    }
+
+    if (needed > 0)
+    {
+        refills_pending += needed;
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    for (int i = 0; i < needed; i++)
+    {
+        CURL *curl = transport_acquire();
+        AuthFetch *fetch = curl != NULL ? new_fetch(curl, auth_header, NULL, NULL) : NULL;
+
+        if (fetch != NULL)
+        {
+            curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
+            curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
+        }
+
+        if (fetch == NULL || !engine_submit(curl, NULL, on_refill_done, fetch))
+        {
+            if (fetch != NULL)
+            {
+                free_fetch(fetch);
+            }
+            transport_release(curl);
+
+            pthread_mutex_lock(&pool_lock);
+            refills_pending--;
+            pthread_mutex_unlock(&pool_lock);
+        }
+    }
+}
+
+void signature_configure(long ttl, int pool_size)
+{
+    pthread_mutex_lock(&pool_lock);
+    if (ttl > 0)
+    {
+        ttl_ms = ttl;
+    }
+    if (pool_size >= 0)
+    {
+        pool_target = pool_size < SIGNATURE_POOL_MAX ? pool_size : SIGNATURE_POOL_MAX;
+    }
+    while (pool_count > pool_target)
+    {
+        pool_remove(pool_count - 1);
+    }
+    pthread_mutex_unlock(&pool_lock);
+}
+
+char *signature_acquire(const char *auth_header, CancelToken *token, int allow_cached,
+                        CURLcode *result, int *cached)
+{
+    *result = CURLE_OK;
+    *cached = 0;
+
+    char *signature = allow_cached ? pool_take() : NULL;
+    if (signature != NULL)
+    {
+        atomic_fetch_add(&stat_hits, 1);
+        *cached = 1;
+        signature_prefetch(auth_header);
+        return signature;
+    }
+
+    atomic_fetch_add(&stat_misses, 1);
+
+    CURL *curl = transport_acquire();
+    if (curl == NULL)
+    {
+        *result = CURLE_FAILED_INIT;
+        return NULL;
+    }
+
+    AuthResponse response;
+    struct curl_slist *headers = prepare_auth_request(curl, auth_header, &response);
+    *result = json_stream_result(&response.stream, engine_perform(curl, token));
+    signature = take_signature(&response, *result);
+
+    curl_slist_free_all(headers);
+    transport_release(curl);
+
+    if (signature != NULL)
+    {
+        pool_store(signature);
+        signature_prefetch(auth_header);
+    }
+
+    return signature;
+}
+
+static void on_acquire_done(CURL *curl, CURLcode result, void *userdata)
+{
+    AuthFetch *fetch = (AuthFetch *)userdata;
+
+    result = json_stream_result(&fetch->response.stream, result);
+    char *signature = take_signature(&fetch->response, result);
+    if (signature != NULL)
+    {
+        pool_store(signature);
+        signature_prefetch(fetch->auth_header);
+    }
+
+    transport_release(curl);
+    fetch->callback(signature, result, 0, fetch->userdata);
+    free_fetch(fetch);
+}
+
+int signature_acquire_async(const char *auth_header, CancelToken *token, int allow_cached,
+                            SignatureCallback callback, void *userdata)
+{
+    char *signature = allow_cached ? pool_take() : NULL;
+    if (signature != NULL)
+    {
+        atomic_fetch_add(&stat_hits, 1);
+        signature_prefetch(auth_header);
+        callback(signature, CURLE_OK, 1, userdata);
+        return 1;
+    }
+
+    atomic_fetch_add(&stat_misses, 1);
+
+    CURL *curl = transport_acquire();
+    if (curl == NULL)
+    {
+        return 0;
+    }
+
+    AuthFetch *fetch = new_fetch(curl, auth_header, callback, userdata);
+    if (fetch == NULL)
+    {
+        transport_release(curl);
+        return 0;
+    }
+
+    if (!engine_submit(curl, token, on_acquire_done, fetch))
+    {
+        free_fetch(fetch);
+        transport_release(curl);
+        return 0;
+    }
+
+    return 1;
+}
+
+int signature_rejected(CURL *curl)
+{
+    long http_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    return http_code == 401 || http_code == 403;
+}
+
+void signature_reject(const char *signature)
+{
+    atomic_fetch_add(&stat_rejections, 1);
+
+    pthread_mutex_lock(&pool_lock);
+    for (int i = 0; i < pool_count; i++)
+    {
+        if (strcmp(pool[i].value, signature) == 0)
+        {
+            pool_remove(i);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pool_lock);
+}
+
+void signature_get_stats(SignatureStats *stats)
+{
+    stats->hits = atomic_load(&stat_hits);
+    stats->misses = atomic_load(&stat_misses);
+    stats->refreshes = atomic_load(&stat_refreshes);
+    stats->rejections = atomic_load(&stat_rejections);
+}
@@ -0,0 +1,32 @@
+#ifndef SIGNATURE_MANAGER_H
+#define SIGNATURE_MANAGER_H
+
+#include <curl/curl.h>
+#include "cancel_token.h"
+
+#define SIGNATURE_POOL_MAX 4
+#define SIGNATURE_DEFAULT_POOL_SIZE 2
+#define SIGNATURE_DEFAULT_TTL_MS (5 * 60 * 1000L)
+
+typedef struct
+{
+    long hits;
+    long misses;
+    long refreshes;
+    long rejections;
+} SignatureStats;
+
+// Receives ownership of signature, which is NULL when the /auth fetch failed.
+typedef void (*SignatureCallback)(char *signature, CURLcode result, int cached, void *userdata);
+
+void signature_configure(long ttl_ms, int pool_size);
+char *signature_acquire(const char *auth_header, CancelToken *token, int allow_cached,
+                        CURLcode *result, int *cached);
+int signature_acquire_async(const char *auth_header, CancelToken *token, int allow_cached,
+                            SignatureCallback callback, void *userdata);
+int signature_rejected(CURL *curl);
+void signature_reject(const char *signature);
+void signature_prefetch(const char *auth_header);
+void signature_get_stats(SignatureStats *stats);
+
+#endif
@@ -0,0 +1,148 @@
+#include <stdlib.h>
+#include <string.h>
+#include "string_builder.h"
+
+static const char HEX[] = "0123456789abcdef";
+
+static size_t put(char *dst, size_t pos, const char *text, size_t len)
+{
+    if (dst != NULL)
+    {
+        memcpy(dst + pos, text, len);
+    }
+    return pos + len;
+}
+
+static size_t put_unicode_escape(char *dst, size_t pos, unsigned int unit)
+{
+    char escape[6] = {'\\', 'u', HEX[(unit >> 12) & 0xF], HEX[(unit >> 8) & 0xF], HEX[(unit >> 4) & 0xF],
+                      HEX[unit & 0xF]};
+    return put(dst, pos, escape, sizeof(escape));
+}
+
+static const char *control_escape(unsigned char c)
+{
+    switch (c)
+    {
+    case '\b':
+        return "\\b";
+    case '\f':
+        return "\\f";
+    case '\n':
+        return "\\n";
+    case '\r':
+        return "\\r";
+    case '\t':
+        return "\\t";
+    default:
+        return NULL;
+    }
+}
+
+// Escapes text for a JSON string literal and returns the escaped length. With
+// a NULL dst only the length is computed, so sizing and writing share one
+// code path. JNI hands out modified UTF-8: an embedded NUL arrives as C0 80
+// and supplementary characters as two 3-byte surrogates, which are rewritten
+// as \u0000 and standard 4-byte UTF-8.
+static size_t escape_json(char *dst, const char *text)
+{
+    const unsigned char *src = (const unsigned char *)text;
+    size_t pos = 0;
+
+    while (*src != '\0')
+    {
+        unsigned char c = *src;
+
+        if (c == '"' || c == '\\')
+        {
+            char escape[2] = {'\\', (char)c};
+            pos = put(dst, pos, escape, 2);
+            src++;
+        }
+        else if (c < 0x20)
+        {
+            const char *named = control_escape(c);
+            pos = named != NULL ? put(dst, pos, named, 2) : put_unicode_escape(dst, pos, c);
+            src++;
+        }
+        else if (c == 0xC0 && src[1] == 0x80)
+        {
+            pos = put_unicode_escape(dst, pos, 0);
+            src += 2;
+        }
+        else if (c == 0xED && (src[1] & 0xF0) == 0xA0 && src[2] != '\0' && src[3] == 0xED &&
+                 (src[4] & 0xF0) == 0xB0 && src[5] != '\0')
+        {
+            unsigned int high = 0xD000 | ((src[1] & 0x3F) << 6) | (src[2] & 0x3F);
+            unsigned int low = 0xD000 | ((src[4] & 0x3F) << 6) | (src[5] & 0x3F);
+            unsigned int cp = 0x10000 + ((high - 0xD800) << 10) + (low - 0xDC00);
+            char utf8[4] = {(char)(0xF0 | (cp >> 18)), (char)(0x80 | ((cp >> 12) & 0x3F)),
+                            (char)(0x80 | ((cp >> 6) & 0x3F)), (char)(0x80 | (cp & 0x3F))};
+            pos = put(dst, pos, utf8, sizeof(utf8));
+            src += 6;
+        }
+        else
+        {
+            // Copy the run of bytes that need no escaping in one go.
+            const unsigned char *run = src;
+            while (*src >= 0x20 && *src != '"' && *src != '\\' && *src != 0xC0 && *src != 0xED)
+            {
+                src++;
+            }
+            if (src == run)
+            {
+                src++;
+            }
+            pos = put(dst, pos, (const char *)run, (size_t)(src - run));
+        }
+    }
+
+    return pos;
+}
+
+size_t json_escaped_length(const char *text)
+{
+    return text != NULL ? escape_json(NULL, text) : 0;
+}
+
+// Sizes every piece first, then allocates once and writes each piece exactly
+// where it belongs; no intermediate buffers and no rescanning.
+char *string_build(const StringPiece *pieces, size_t count)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (pieces[i].text != NULL)
+        {
+            total += pieces[i].kind == PIECE_JSON ? escape_json(NULL, pieces[i].text) : strlen(pieces[i].text);
+        }
+    }
+
+    char *result = (char *)malloc(total + 1);
+    if (result == NULL)
+    {
+        return NULL;
+    }
+
+    size_t pos = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const char *text = pieces[i].text;
+        if (text == NULL)
+        {
+            continue;
+        }
+
+        if (pieces[i].kind == PIECE_JSON)
+        {
+            pos += escape_json(result + pos, text);
+        }
+        else
+        {
+            pos = put(result, pos, text, strlen(text));
+        }
+    }
+    result[pos] = '\0';
+
+    return result;
+}
@@ -0,0 +1,26 @@
+#ifndef STRING_BUILDER_H
+#define STRING_BUILDER_H
+
+#include <stddef.h>
+
+typedef enum
+{
+    PIECE_RAW,
+    PIECE_JSON
+} PieceKind;
+
+// One segment of a string under construction. JSON pieces are escaped for
+// use inside a JSON string literal; a NULL text is treated as empty.
+typedef struct
+{
+    const char *text;
+    PieceKind kind;
+} StringPiece;
+
+#define PIECE(s) ((StringPiece){(s), PIECE_RAW})
+#define JSON_PIECE(s) ((StringPiece){(s), PIECE_JSON})
+
+size_t json_escaped_length(const char *text);
+char *string_build(const StringPiece *pieces, size_t count);
+
+#endif
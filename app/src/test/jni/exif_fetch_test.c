@@ -0,0 +1,317 @@
+// Runs the ranged EXIF scan in exif_fetch.c against a scripted server that
+// stands in for curl and the engine: the comment in the first window, after
+// the window has grown, from a server that ignores Range, and past the scan
+// limit. Reports how many requests and bytes each scan cost.
+
+#define CURL_DISABLE_TYPECHECK
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "exif_fetch.h"
+
+#define COMMENT "fourth-fragment-value"
+#define CHUNK 1024
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                  \
+    do                                                    \
+    {                                                     \
+        if (!(cond))                                      \
+        {                                                 \
+            fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                 \
+            fputc('\n', stderr);                          \
+            failures++;                                   \
+        }                                                 \
+    } while (0)
+
+// The scripted server and the state curl would keep on the handle.
+typedef struct
+{
+    const unsigned char *image;
+    size_t image_len;
+    int honour_range;
+
+    curl_write_callback write;
+    void *write_data;
+    char range[64];
+    long http_code;
+    curl_off_t content_length;
+
+    int requests;
+    size_t bytes_sent;
+} FakeServer;
+
+static FakeServer server;
+
+CURLcode curl_easy_setopt(CURL *curl, CURLoption option, ...)
+{
+    va_list args;
+    va_start(args, option);
+    switch (option)
+    {
+    case CURLOPT_WRITEFUNCTION:
+        server.write = va_arg(args, curl_write_callback);
+        break;
+    case CURLOPT_WRITEDATA:
+        server.write_data = va_arg(args, void *);
+        break;
+    case CURLOPT_RANGE:
+        snprintf(server.range, sizeof(server.range), "%s", va_arg(args, const char *));
+        break;
+    default:
+        break;
+    }
+    va_end(args);
+    return CURLE_OK;
+}
+
+CURLcode curl_easy_getinfo(CURL *curl, CURLINFO info, ...)
+{
+    va_list args;
+    va_start(args, info);
+    if (info == CURLINFO_RESPONSE_CODE)
+    {
+        *va_arg(args, long *) = server.http_code;
+    }
+    else if (info == CURLINFO_CONTENT_LENGTH_DOWNLOAD_T)
+    {
+        *va_arg(args, curl_off_t *) = server.content_length;
+    }
+    va_end(args);
+    return CURLE_OK;
+}
+
+CURLcode engine_perform(CURL *curl, CancelToken *token)
+{
+    size_t start = 0;
+    size_t end = server.image_len;
+    server.requests++;
+
+    if (server.honour_range)
+    {
+        unsigned long first = 0, last = 0;
+        sscanf(server.range, "%lu-%lu", &first, &last);
+        if (first >= server.image_len)
+        {
+            server.http_code = 416;
+            server.content_length = 0;
+            return CURLE_OK;
+        }
+        start = first;
+        end = last + 1 < server.image_len ? last + 1 : server.image_len;
+        server.http_code = 206;
+    }
+    else
+    {
+        server.http_code = 200;
+    }
+    server.content_length = (curl_off_t)(end - start);
+
+    for (size_t pos = start; pos < end; pos += CHUNK)
+    {
+        size_t len = end - pos < CHUNK ? end - pos : CHUNK;
+        size_t taken = server.write((char *)server.image + pos, 1, len, server.write_data);
+        server.bytes_sent += len;
+        if (taken != len)
+        {
+            return CURLE_WRITE_ERROR;
+        }
+    }
+    return CURLE_OK;
+}
+
+typedef struct
+{
+    unsigned char *data;
+    size_t len;
+} Image;
+
+static void put(Image *image, const void *data, size_t len)
+{
+    image->data = (unsigned char *)realloc(image->data, image->len + len);
+    memcpy(image->data + image->len, data, len);
+    image->len += len;
+}
+
+static void put_segment(Image *image, unsigned char marker, const unsigned char *payload, size_t len)
+{
+    unsigned char header[4] = {0xFF, marker, (unsigned char)((len + 2) >> 8), (unsigned char)(len + 2)};
+    put(image, header, sizeof(header));
+    put(image, payload, len);
+}
+
+// A little-endian Exif APP1 segment: IFD0 points at the Exif IFD, which holds
+// an UNDEFINED UserComment with the ASCII charset prefix.
+static void put_exif(Image *image, const char *comment)
+{
+    size_t count = 8 + strlen(comment);
+    unsigned char app1[256] = {'E', 'x', 'i', 'f', 0, 0};
+    unsigned char *tiff = app1 + 6;
+    const unsigned char head[] = {
+        'I', 'I', 42, 0, 8, 0, 0, 0,
+        1, 0, 0x69, 0x87, 4, 0, 1, 0, 0, 0, 26, 0, 0, 0, 0, 0, 0, 0,
+        1, 0, 0x86, 0x92, 7, 0, (unsigned char)count, 0, 0, 0, 44, 0, 0, 0, 0, 0, 0, 0,
+        'A', 'S', 'C', 'I', 'I', 0, 0, 0};
+    memcpy(tiff, head, sizeof(head));
+    memcpy(tiff + sizeof(head), comment, strlen(comment));
+    put_segment(image, 0xE1, app1, 6 + sizeof(head) + strlen(comment));
+}
+
+// SOI, `padding` bytes of COM segments, the Exif segment, then scan data.
+static Image build_image(size_t padding, size_t scan_len)
+{
+    static unsigned char filler[60000];
+    Image image = {NULL, 0};
+    const unsigned char soi[] = {0xFF, 0xD8};
+    put(&image, soi, sizeof(soi));
+
+    while (padding > 0)
+    {
+        size_t len = padding < sizeof(filler) ? padding : sizeof(filler);
+        put_segment(&image, 0xFE, filler, len);
+        padding -= len;
+    }
+
+    put_exif(&image, COMMENT);
+
+    const unsigned char sos[] = {0xFF, 0xDA, 0, 2};
+    put(&image, sos, sizeof(sos));
+    unsigned char *scan = (unsigned char *)calloc(scan_len, 1);
+    put(&image, scan, scan_len);
+    free(scan);
+    return image;
+}
+
+static char *scan(const Image *image, int honour_range, double *elapsed_us)
+{
+    memset(&server, 0, sizeof(server));
+    server.image = image->data;
+    server.image_len = image->len;
+    server.honour_range = honour_range;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    char *comment = exif_fetch_comment(NULL, "https://example.invalid/image.jpg", NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    *elapsed_us = (double)(end.tv_sec - start.tv_sec) * 1e6 + (double)(end.tv_nsec - start.tv_nsec) / 1e3;
+    return comment;
+}
+
+static int is_comment(const char *comment)
+{
+    return comment != NULL && strcmp(comment, COMMENT) == 0;
+}
+
+static void report(const char *name, double elapsed_us)
+{
+    printf("  %-28s %d request(s), %zu bytes, %.0f us\n", name, server.requests, server.bytes_sent, elapsed_us);
+}
+
+static void test_found_in_first_window(void)
+{
+    Image image = build_image(0, 2 * 1024 * 1024);
+    double us;
+    char *comment = scan(&image, 1, &us);
+    report("first window", us);
+
+    CHECK(is_comment(comment), "got %s", comment ? comment : "NULL");
+    CHECK(server.requests == 1, "%d requests", server.requests);
+    CHECK(server.bytes_sent < EXIF_RANGE_INITIAL, "received the whole window: %zu bytes", server.bytes_sent);
+
+    free(comment);
+    free(image.data);
+}
+
+static void test_short_tail_is_drained(void)
+{
+    // The whole image fits in the first window, so the tail after the
+    // comment is short enough to drain and the transfer completes.
+    Image image = build_image(0, 2000);
+    double us;
+    char *comment = scan(&image, 1, &us);
+    report("short tail drained", us);
+
+    CHECK(is_comment(comment), "got %s", comment ? comment : "NULL");
+    CHECK(server.bytes_sent == image.len, "drained %zu of %zu bytes", server.bytes_sent, image.len);
+
+    free(comment);
+    free(image.data);
+}
+
+static void test_found_after_window_grows(void)
+{
+    Image image = build_image(150000, 2 * 1024 * 1024);
+    double us;
+    char *comment = scan(&image, 1, &us);
+    report("grown window", us);
+
+    CHECK(is_comment(comment), "got %s", comment ? comment : "NULL");
+    CHECK(server.requests > 1, "expected the window to grow, %d requests", server.requests);
+    CHECK(server.bytes_sent < 150000 + EXIF_RANGE_MAX, "read %zu bytes", server.bytes_sent);
+
+    free(comment);
+    free(image.data);
+}
+
+static void test_range_ignored(void)
+{
+    Image image = build_image(30000, 2 * 1024 * 1024);
+    double us;
+    char *comment = scan(&image, 0, &us);
+    report("range ignored (200)", us);
+
+    CHECK(is_comment(comment), "got %s", comment ? comment : "NULL");
+    CHECK(server.requests == 1, "%d requests", server.requests);
+    CHECK(server.bytes_sent < 30000 + 2 * CHUNK, "kept reading after the comment: %zu bytes", server.bytes_sent);
+
+    free(comment);
+    free(image.data);
+}
+
+static void test_scan_limit(void)
+{
+    Image image = build_image(EXIF_SCAN_MAX + 200000, 1024);
+    double us;
+
+    char *comment = scan(&image, 1, &us);
+    report("scan limit (ranged)", us);
+    CHECK(comment == NULL, "found a comment past the scan limit");
+    CHECK(server.bytes_sent <= EXIF_SCAN_MAX + EXIF_RANGE_MAX, "read %zu bytes", server.bytes_sent);
+    free(comment);
+
+    comment = scan(&image, 0, &us);
+    report("scan limit (200)", us);
+    CHECK(comment == NULL, "found a comment past the scan limit");
+    CHECK(server.bytes_sent <= EXIF_SCAN_MAX + CHUNK, "read %zu bytes", server.bytes_sent);
+    free(comment);
+
+    free(image.data);
+}
+
+int main(void)
+{
+    struct
+    {
+        const char *name;
+        void (*run)(void);
+    } tests[] = {
+        {"found_in_first_window", test_found_in_first_window},
+        {"short_tail_is_drained", test_short_tail_is_drained},
+        {"found_after_window_grows", test_found_after_window_grows},
+        {"range_ignored", test_range_ignored},
+        {"scan_limit", test_scan_limit},
+    };
+
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+    {
+        int before = failures;
+        tests[i].run();
+        printf("%s %s\n", failures == before ? "ok" : "FAILED", tests[i].name);
+    }
+
+    return failures == 0 ? 0 : 1;
+}
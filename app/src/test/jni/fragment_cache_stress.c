@@ -0,0 +1,375 @@
+// Stress test for the single-flight fragment caches: many threads miss the
+// same cache at once, with tokens that are live, cancelled or expiring, and
+// fetches that succeed, fail or abort. Run under NATIVE_TESTS_TSAN to have
+// ThreadSanitizer check the publish and wait paths as well.
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cancel_token.h"
+#include "fragment_cache.h"
+
+#define FRAGMENT_VALUE "fragment-value"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                  \
+    do                                                    \
+    {                                                     \
+        if (!(cond))                                      \
+        {                                                 \
+            fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                 \
+            fputc('\n', stderr);                          \
+            failures++;                                   \
+        }                                                 \
+    } while (0)
+
+typedef struct
+{
+    atomic_int fetches;
+    atomic_int in_flight;
+    atomic_int max_in_flight;
+    int delay_ms;
+    int fail_percent;
+    int honour_token;
+} FetchScript;
+
+typedef struct
+{
+    FragmentCache *cache;
+    FetchScript *script;
+    pthread_barrier_t *barrier;
+    long timeout_ms;
+    char *result;
+    long long elapsed_ms;
+} Caller;
+
+static void sleep_ms(long ms)
+{
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+static unsigned next_random(void)
+{
+    static _Thread_local unsigned state = 0;
+    if (state == 0)
+    {
+        state = (unsigned)(uintptr_t)&state ^ (unsigned)monotonic_ms();
+    }
+    state = state * 1103515245u + 12345u;
+    return state >> 8;
+}
+
+static void script_init(FetchScript *script, int delay_ms, int fail_percent, int honour_token)
+{
+    atomic_init(&script->fetches, 0);
+    atomic_init(&script->in_flight, 0);
+    atomic_init(&script->max_in_flight, 0);
+    script->delay_ms = delay_ms;
+    script->fail_percent = fail_percent;
+    script->honour_token = honour_token;
+}
+
+// Stands in for the network fetch. With honour_token it gives up as soon as
+// the token expires, the way an engine transfer is aborted.
+static char *scripted_fetch(CancelToken *token, void *ctx)
+{
+    FetchScript *script = (FetchScript *)ctx;
+
+    atomic_fetch_add(&script->fetches, 1);
+    int now = atomic_fetch_add(&script->in_flight, 1) + 1;
+    int seen = atomic_load(&script->max_in_flight);
+    while (now > seen && !atomic_compare_exchange_weak(&script->max_in_flight, &seen, now))
+    {
+    }
+
+    long long until = monotonic_ms() + script->delay_ms;
+    int aborted = 0;
+    while (monotonic_ms() < until)
+    {
+        if (script->honour_token && cancel_token_expired(token))
+        {
+            aborted = 1;
+            break;
+        }
+        sleep_ms(1);
+    }
+
+    int failed = aborted || (script->fail_percent > 0 && (int)(next_random() % 100) < script->fail_percent);
+    atomic_fetch_sub(&script->in_flight, 1);
+
+    return failed ? NULL : strdup(FRAGMENT_VALUE);
+}
+
+static void *caller_thread(void *arg)
+{
+    Caller *caller = (Caller *)arg;
+
+    CancelToken *token = cancel_token_new();
+    cancel_token_set_timeout(token, caller->timeout_ms);
+
+    if (caller->barrier != NULL)
+    {
+        pthread_barrier_wait(caller->barrier);
+    }
+
+    long long started = monotonic_ms();
+    caller->result = fragment_cache_get(caller->cache, scripted_fetch, token, caller->script);
+    caller->elapsed_ms = monotonic_ms() - started;
+
+    cancel_token_release(token);
+    return NULL;
+}
+
+static void run_callers(Caller *callers, int count)
+{
+    pthread_t threads[64];
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, (unsigned)count);
+
+    for (int i = 0; i < count; i++)
+    {
+        callers[i].barrier = &barrier;
+        pthread_create(&threads[i], NULL, caller_thread, &callers[i]);
+    }
+    for (int i = 0; i < count; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_barrier_destroy(&barrier);
+}
+
+static int is_value(const char *result)
+{
+    return result != NULL && strcmp(result, FRAGMENT_VALUE) == 0;
+}
+
+static void test_concurrent_misses_share_one_fetch(void)
+{
+    for (int round = 0; round < 50; round++)
+    {
+        FragmentCache cache = FRAGMENT_CACHE_INIT;
+        FetchScript script;
+        script_init(&script, 5, 0, 0);
+
+        Caller callers[32] = {{0}};
+        for (int i = 0; i < 32; i++)
+        {
+            callers[i].cache = &cache;
+            callers[i].script = &script;
+        }
+        run_callers(callers, 32);
+
+        for (int i = 0; i < 32; i++)
+        {
+            CHECK(is_value(callers[i].result), "round %d caller %d got %s", round, i,
+                  callers[i].result ? callers[i].result : "NULL");
+            free(callers[i].result);
+        }
+        CHECK(atomic_load(&script.fetches) == 1, "round %d ran %d fetches", round, atomic_load(&script.fetches));
+        CHECK(atomic_load(&script.max_in_flight) == 1, "round %d overlapped fetches", round);
+
+        fragment_cache_clear(&cache);
+    }
+}
+
+static void test_failed_fetch_is_not_published(void)
+{
+    for (int round = 0; round < 20; round++)
+    {
+        FragmentCache cache = FRAGMENT_CACHE_INIT;
+        FetchScript script;
+        script_init(&script, 2, 100, 0);
+
+        Caller callers[32] = {{0}};
+        for (int i = 0; i < 32; i++)
+        {
+            callers[i].cache = &cache;
+            callers[i].script = &script;
+        }
+        run_callers(callers, 32);
+
+        for (int i = 0; i < 32; i++)
+        {
+            CHECK(callers[i].result == NULL, "round %d caller %d got a value from a failing fetch", round, i);
+        }
+        CHECK(atomic_load(&script.max_in_flight) == 1, "round %d overlapped fetches", round);
+        CHECK(fragment_cache_peek(&cache) == NULL, "round %d published a failed fetch", round);
+    }
+}
+
+static void test_cancelled_waiters_leave_early(void)
+{
+    FragmentCache cache = FRAGMENT_CACHE_INIT;
+    FetchScript script;
+    script_init(&script, 400, 0, 0);
+
+    Caller initiator = {&cache, &script, NULL, 0, NULL, 0};
+    pthread_t initiator_thread;
+    pthread_create(&initiator_thread, NULL, caller_thread, &initiator);
+    sleep_ms(20);
+
+    Caller waiters[16] = {{0}};
+    for (int i = 0; i < 16; i++)
+    {
+        waiters[i].cache = &cache;
+        waiters[i].script = &script;
+        waiters[i].timeout_ms = 30;
+    }
+    run_callers(waiters, 16);
+
+    for (int i = 0; i < 16; i++)
+    {
+        CHECK(waiters[i].result == NULL, "waiter %d outlived its deadline with a value", i);
+        CHECK(waiters[i].elapsed_ms < 200, "waiter %d took %lld ms to notice its deadline", i,
+              waiters[i].elapsed_ms);
+    }
+
+    pthread_join(initiator_thread, NULL);
+    CHECK(is_value(initiator.result), "initiator lost its fetch to the waiters' deadlines");
+    CHECK(atomic_load(&script.fetches) == 1, "waiters started %d fetches", atomic_load(&script.fetches));
+
+    free(initiator.result);
+    fragment_cache_clear(&cache);
+}
+
+static void test_live_waiter_takes_over_aborted_fetch(void)
+{
+    FragmentCache cache = FRAGMENT_CACHE_INIT;
+    FetchScript script;
+    script_init(&script, 200, 0, 1);
+
+    Caller initiator = {&cache, &script, NULL, 30, NULL, 0};
+    pthread_t initiator_thread;
+    pthread_create(&initiator_thread, NULL, caller_thread, &initiator);
+    sleep_ms(10);
+
+    Caller waiters[8] = {{0}};
+    for (int i = 0; i < 8; i++)
+    {
+        waiters[i].cache = &cache;
+        waiters[i].script = &script;
+    }
+    run_callers(waiters, 8);
+    pthread_join(initiator_thread, NULL);
+
+    CHECK(initiator.result == NULL, "initiator returned a value past its deadline");
+    for (int i = 0; i < 8; i++)
+    {
+        CHECK(is_value(waiters[i].result), "waiter %d failed with the aborted fetch", i);
+        free(waiters[i].result);
+    }
+    CHECK(atomic_load(&script.fetches) == 2, "expected one aborted and one completed fetch, ran %d",
+          atomic_load(&script.fetches));
+    CHECK(atomic_load(&script.max_in_flight) == 1, "takeover overlapped the aborted fetch");
+
+    fragment_cache_clear(&cache);
+}
+
+typedef struct
+{
+    FragmentCache *cache;
+    FetchScript *script;
+    pthread_barrier_t *barrier;
+    atomic_int *bad_results;
+} MixedCaller;
+
+static void *mixed_thread(void *arg)
+{
+    MixedCaller *caller = (MixedCaller *)arg;
+    pthread_barrier_wait(caller->barrier);
+
+    for (int i = 0; i < 20; i++)
+    {
+        CancelToken *token = cancel_token_new();
+        unsigned pick = next_random() % 4;
+        if (pick == 0)
+        {
+            cancel_token_cancel(token);
+        }
+        else if (pick != 1)
+        {
+            cancel_token_set_timeout(token, 1 + (long)(next_random() % 10));
+        }
+
+        char *result = fragment_cache_get(caller->cache, scripted_fetch, token, caller->script);
+        if (result != NULL && !is_value(result))
+        {
+            atomic_fetch_add(caller->bad_results, 1);
+        }
+        free(result);
+        cancel_token_release(token);
+    }
+    return NULL;
+}
+
+static void test_mixed_load(void)
+{
+    for (int round = 0; round < 100; round++)
+    {
+        FragmentCache cache = FRAGMENT_CACHE_INIT;
+        FetchScript script;
+        script_init(&script, 2, 30, 1);
+        atomic_int bad_results;
+        atomic_init(&bad_results, 0);
+
+        pthread_t threads[64];
+        MixedCaller callers[64];
+        pthread_barrier_t barrier;
+        pthread_barrier_init(&barrier, NULL, 64);
+
+        for (int i = 0; i < 64; i++)
+        {
+            callers[i] = (MixedCaller){&cache, &script, &barrier, &bad_results};
+            pthread_create(&threads[i], NULL, mixed_thread, &callers[i]);
+        }
+        for (int i = 0; i < 64; i++)
+        {
+            pthread_join(threads[i], NULL);
+        }
+        pthread_barrier_destroy(&barrier);
+
+        CHECK(atomic_load(&bad_results) == 0, "round %d returned %d corrupt values", round,
+              atomic_load(&bad_results));
+        CHECK(atomic_load(&script.max_in_flight) == 1, "round %d overlapped fetches", round);
+
+        // Whatever happened above, a live caller still gets the value.
+        script.fail_percent = 0;
+        char *value = fragment_cache_get(&cache, scripted_fetch, NULL, &script);
+        CHECK(is_value(value), "round %d left the cache unusable", round);
+        free(value);
+
+        fragment_cache_clear(&cache);
+    }
+}
+
+int main(void)
+{
+    struct
+    {
+        const char *name;
+        void (*run)(void);
+    } tests[] = {
+        {"concurrent_misses_share_one_fetch", test_concurrent_misses_share_one_fetch},
+        {"failed_fetch_is_not_published", test_failed_fetch_is_not_published},
+        {"cancelled_waiters_leave_early", test_cancelled_waiters_leave_early},
+        {"live_waiter_takes_over_aborted_fetch", test_live_waiter_takes_over_aborted_fetch},
+        {"mixed_load", test_mixed_load},
+    };
+
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+    {
+        int before = failures;
+        tests[i].run();
+        printf("%s %s\n", failures == before ? "ok" : "FAILED", tests[i].name);
+    }
+
+    return failures == 0 ? 0 : 1;
+}
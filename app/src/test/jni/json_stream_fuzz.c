@@ -0,0 +1,390 @@
+// Split-feed and fuzz tests for json_stream_feed. A body fed in arbitrary
+// pieces must give exactly the result of feeding it whole; a fixed corpus
+// pins the expected values for escapes, surrogate pairs, the depth limit, raw
+// root values and overflow, and random documents and mutations cover the
+// rest. Ends with a throughput figure for a large body.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "json_stream.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                  \
+    do                                                    \
+    {                                                     \
+        if (!(cond))                                      \
+        {                                                 \
+            fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                 \
+            fputc('\n', stderr);                          \
+            failures++;                                   \
+        }                                                 \
+    } while (0)
+
+#define FIELD_COUNT 2
+
+typedef struct
+{
+    JsonStatus status;
+    JsonField fields[FIELD_COUNT];
+} Result;
+
+static unsigned next_random(void)
+{
+    static unsigned state = 88172645u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Feeds doc in pieces no longer than max_piece (0 feeds it whole) and
+// finishes the stream. root selects the bare-root field instead of members.
+static void parse(const char *doc, size_t len, int root, size_t max_piece, Result *result)
+{
+    memset(result, 0, sizeof(*result));
+    result->fields[0].name = root ? NULL : "signature";
+    result->fields[1].name = "url";
+
+    JsonStream stream;
+    json_stream_init(&stream, result->fields, root ? 1 : FIELD_COUNT);
+
+    size_t pos = 0;
+    while (pos < len)
+    {
+        size_t piece = max_piece == 0 ? len - pos : 1 + next_random() % max_piece;
+        if (piece > len - pos)
+        {
+            piece = len - pos;
+        }
+        json_stream_feed(&stream, doc + pos, piece);
+        pos += piece;
+    }
+    result->status = json_stream_finish(&stream);
+}
+
+static int same_result(const Result *a, const Result *b)
+{
+    if (a->status != b->status)
+    {
+        return 0;
+    }
+    for (int i = 0; i < FIELD_COUNT; i++)
+    {
+        const JsonField *x = &a->fields[i];
+        const JsonField *y = &b->fields[i];
+        if (x->found != y->found || x->overflow != y->overflow || x->len != y->len ||
+            memcmp(x->value, y->value, x->len) != 0)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Every two-piece split, then random splits down to single bytes.
+static void check_splits(const char *doc, size_t len, int root, const char *label)
+{
+    Result whole, split;
+    parse(doc, len, root, 0, &whole);
+
+    for (size_t cut = 1; cut < len && len <= 4096; cut++)
+    {
+        memset(&split, 0, sizeof(split));
+        split.fields[0].name = root ? NULL : "signature";
+        split.fields[1].name = "url";
+        JsonStream stream;
+        json_stream_init(&stream, split.fields, root ? 1 : FIELD_COUNT);
+        json_stream_feed(&stream, doc, cut);
+        json_stream_feed(&stream, doc + cut, len - cut);
+        split.status = json_stream_finish(&stream);
+
+        if (!same_result(&whole, &split))
+        {
+            CHECK(0, "%s: split at %zu differs from the whole feed", label, cut);
+            return;
+        }
+    }
+
+    for (int round = 0; round < 64; round++)
+    {
+        parse(doc, len, root, round % 8 + 1, &split);
+        if (!same_result(&whole, &split))
+        {
+            CHECK(0, "%s: random split (pieces <= %d) differs from the whole feed", label, round % 8 + 1);
+            return;
+        }
+    }
+}
+
+typedef struct
+{
+    const char *label;
+    const char *doc;
+    int root;
+    JsonStatus status;
+    const char *signature;
+    const char *url;
+} Case;
+
+static char deep_ok[256];
+static char deep_fail[256];
+static char long_value[JSON_VALUE_MAX + 64];
+
+static void build_generated_cases(void)
+{
+    // One object plus arrays: the object counts towards the depth.
+    char *p = deep_ok;
+    p += sprintf(p, "{\"d\":");
+    for (int i = 0; i < JSON_DEPTH_MAX - 1; i++)
+    {
+        *p++ = '[';
+    }
+    for (int i = 0; i < JSON_DEPTH_MAX - 1; i++)
+    {
+        *p++ = ']';
+    }
+    sprintf(p, ",\"signature\":\"deep\",\"url\":\"u\"}");
+
+    p = deep_fail;
+    p += sprintf(p, "{\"d\":");
+    for (int i = 0; i < JSON_DEPTH_MAX; i++)
+    {
+        *p++ = '[';
+    }
+    for (int i = 0; i < JSON_DEPTH_MAX; i++)
+    {
+        *p++ = ']';
+    }
+    sprintf(p, ",\"signature\":\"deep\",\"url\":\"u\"}");
+
+    p = long_value;
+    p += sprintf(p, "{\"signature\":\"");
+    memset(p, 'v', JSON_VALUE_MAX);
+    sprintf(p + JSON_VALUE_MAX, "\"}");
+}
+
+static void test_corpus(void)
+{
+    build_generated_cases();
+
+    const Case cases[] = {
+        {"plain", "{\"signature\":\"abc\",\"url\":\"/x.png\"}", 0, JSON_DONE, "abc", "/x.png"},
+        {"whitespace", " {\n\t\"url\" : \"u\" ,\r\n \"signature\"\t:\t\"s\" } ", 0, JSON_DONE, "s", "u"},
+        {"escapes", "{\"signature\":\"q\\\"b\\\\s\\/b\\bf\\fn\\nr\\rt\\t\",\"url\":\"\"}", 0, JSON_DONE,
+         "q\"b\\s/b\bf\fn\nr\rt\t", ""},
+        {"unicode", "{\"signature\":\"\\u0041\\u00e9\\u4e2d\",\"url\":\"u\"}", 0, JSON_DONE, "A\xc3\xa9\xe4\xb8\xad", "u"},
+        {"surrogate pair", "{\"signature\":\"\\ud83d\\ude00!\",\"url\":\"u\"}", 0, JSON_DONE, "\xf0\x9f\x98\x80!", "u"},
+        {"lone high surrogate", "{\"signature\":\"\\ud83dx\",\"url\":\"u\"}", 0, JSON_DONE, "\xef\xbf\xbdx", "u"},
+        {"lone low surrogate", "{\"signature\":\"\\ude00\",\"url\":\"u\"}", 0, JSON_DONE, "\xef\xbf\xbd", "u"},
+        {"nested member ignored", "{\"a\":{\"signature\":\"inner\"},\"signature\":\"outer\",\"url\":\"u\"}", 0, JSON_DONE,
+         "outer", "u"},
+        {"other values skipped", "{\"n\":-1.5e3,\"t\":true,\"z\":null,\"l\":[1,\"s\",{}],\"signature\":\"s\",\"url\":\"u\"}",
+         0, JSON_DONE, "s", "u"},
+        {"missing field", "{\"signature\":\"s\"}", 0, JSON_ERROR, "s", NULL},
+        {"bad escape", "{\"signature\":\"\\x\",\"url\":\"u\"}", 0, JSON_ERROR, NULL, NULL},
+        {"bad unicode", "{\"signature\":\"\\u12g4\",\"url\":\"u\"}", 0, JSON_ERROR, NULL, NULL},
+        {"mismatched close", "{\"x\":[1},\"signature\":\"s\",\"url\":\"u\"}", 0, JSON_ERROR, NULL, NULL},
+        {"depth limit ok", deep_ok, 0, JSON_DONE, "deep", "u"},
+        {"depth limit exceeded", deep_fail, 0, JSON_ERROR, NULL, NULL},
+        {"overflow", long_value, 0, JSON_ERROR, NULL, NULL},
+        {"root string", "\"/images/a\\/b.png\"", 1, JSON_DONE, "/images/a/b.png", NULL},
+        {"root raw", "  /images/a.png \r\n", 1, JSON_DONE, "/images/a.png", NULL},
+        {"root raw empty", "   ", 1, JSON_ERROR, NULL, NULL},
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        const Case *c = &cases[i];
+        const char *doc = c->doc;
+
+        Result result;
+        parse(doc, strlen(doc), c->root, 0, &result);
+
+        CHECK(result.status == c->status, "%s: status %d, expected %d", c->label, result.status, c->status);
+        const JsonField *signature = &result.fields[0];
+        const JsonField *url = &result.fields[1];
+        if (c->signature != NULL)
+        {
+            CHECK(signature->found && strcmp(signature->value, c->signature) == 0, "%s: signature '%s'", c->label,
+                  signature->found ? signature->value : "(missing)");
+        }
+        else
+        {
+            CHECK(!signature->found, "%s: unexpected signature '%s'", c->label, signature->value);
+        }
+        if (!c->root && c->url != NULL)
+        {
+            CHECK(url->found && strcmp(url->value, c->url) == 0, "%s: url '%s'", c->label,
+                  url->found ? url->value : "(missing)");
+        }
+
+        check_splits(doc, strlen(doc), c->root, c->label);
+    }
+
+    Result result;
+    parse(long_value, strlen(long_value), 0, 0, &result);
+    CHECK(result.fields[0].overflow, "overflow: the long value was not flagged");
+}
+
+// Random documents built from the pieces the tokenizer finds hardest:
+// escapes, \u sequences and surrogates, nesting, literals and whitespace.
+static size_t random_string(char *out)
+{
+    static const char *pieces[] = {"a", "Z", " ", "\\\"", "\\\\", "\\/", "\\n", "\\t", "\\u0041",
+                                   "\\u00e9", "\\ud83d\\ude00", "\\ud83d", "\\ude00", "\xe4\xb8\xad", ":", ","};
+    size_t len = 0;
+    out[len++] = '"';
+    int count = (int)(next_random() % 12);
+    for (int i = 0; i < count; i++)
+    {
+        const char *piece = pieces[next_random() % (sizeof(pieces) / sizeof(pieces[0]))];
+        memcpy(out + len, piece, strlen(piece));
+        len += strlen(piece);
+    }
+    out[len++] = '"';
+    return len;
+}
+
+static size_t random_value(char *out, int depth)
+{
+    static const char *spaces[] = {"", " ", "\n", "\t ", "\r\n"};
+    unsigned pick = next_random() % (depth > 4 ? 3 : 5);
+    size_t len = 0;
+
+    switch (pick)
+    {
+    case 0:
+        return random_string(out);
+    case 1:
+    {
+        static const char *literals[] = {"true", "false", "null", "0", "-12.5e-3"};
+        const char *literal = literals[next_random() % 5];
+        memcpy(out, literal, strlen(literal));
+        return strlen(literal);
+    }
+    case 2:
+        memcpy(out, "[]", 2);
+        return 2;
+    case 3:
+    {
+        out[len++] = '[';
+        int count = (int)(next_random() % 4);
+        for (int i = 0; i < count; i++)
+        {
+            if (i > 0)
+                out[len++] = ',';
+            len += random_value(out + len, depth + 1);
+        }
+        out[len++] = ']';
+        return len;
+    }
+    default:
+    {
+        static const char *keys[] = {"\"signature\"", "\"url\"", "\"sig\\u006eature\"", "\"other\"", "\"u\\rl\""};
+        out[len++] = '{';
+        int count = (int)(next_random() % 4);
+        for (int i = 0; i < count; i++)
+        {
+            if (i > 0)
+                out[len++] = ',';
+            const char *space = spaces[next_random() % 5];
+            const char *key = keys[next_random() % 5];
+            len += (size_t)sprintf(out + len, "%s%s%s:%s", space, key, space, space);
+            len += random_value(out + len, depth + 1);
+        }
+        out[len++] = '}';
+        return len;
+    }
+    }
+}
+
+static void test_random_documents(void)
+{
+    static char doc[1 << 16];
+
+    for (int round = 0; round < 2000; round++)
+    {
+        size_t len;
+        int root = round % 5 == 0;
+        if (root)
+        {
+            len = next_random() % 2 ? random_string(doc) : random_value(doc, 0);
+        }
+        else
+        {
+            len = (size_t)sprintf(doc, "{\"signature\":");
+            len += random_value(doc + len, 1);
+            doc[len++] = ',';
+            len += (size_t)sprintf(doc + len, "\"x\":");
+            len += random_value(doc + len, 1);
+            len += (size_t)sprintf(doc + len, ",\"url\":");
+            len += random_string(doc + len);
+            doc[len++] = '}';
+        }
+
+        // Some rounds mutate a byte, so malformed input is split too.
+        if (round % 4 == 3 && len > 0)
+        {
+            doc[next_random() % len] = (char)(next_random() % 128);
+        }
+        doc[len] = '\0';
+
+        char label[32];
+        snprintf(label, sizeof(label), "random document %d", round);
+        check_splits(doc, len, root, label);
+    }
+}
+
+static void bench_throughput(void)
+{
+    enum
+    {
+        ITERATIONS = 200
+    };
+    static char doc[JSON_BODY_MAX];
+    size_t len = (size_t)sprintf(doc, "{\"data\":[");
+    while (len < sizeof(doc) - 256)
+    {
+        len += (size_t)sprintf(doc + len, "{\"id\":%zu,\"name\":\"item \\u00e9\\n\",\"ok\":true},", len);
+    }
+    len += (size_t)sprintf(doc + len, "{}],\"signature\":\"s\",\"url\":\"u\"}");
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        Result result;
+        parse(doc, len, 0, 0, &result);
+        CHECK(result.status == JSON_DONE, "throughput body did not parse");
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double us = (double)(end.tv_sec - start.tv_sec) * 1e6 + (double)(end.tv_nsec - start.tv_nsec) / 1e3;
+    printf("  json_stream_feed %.1f MB/s over a %zu byte body\n", (double)len * ITERATIONS / us, len);
+}
+
+int main(void)
+{
+    struct
+    {
+        const char *name;
+        void (*run)(void);
+    } tests[] = {
+        {"corpus", test_corpus},
+        {"random_documents", test_random_documents},
+        {"bench_throughput", bench_throughput},
+    };
+
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+    {
+        int before = failures;
+        tests[i].run();
+        printf("%s %s\n", failures == before ? "ok" : "FAILED", tests[i].name);
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,260 @@
+// Equivalence tests and microbenchmarks for native_crypto. The base64 vector
+// path compiled into this build (SSSE3 on x86, NEON on ARM) is checked
+// against the scalar path and OpenSSL on random input, padded and unpadded;
+// the timings compare both paths with EVP_DecodeBlock, and the per-thread
+// cipher contexts with a context allocated per call.
+
+// Built into this file so the test can switch the block decoder.
+#include "base64.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <openssl/evp.h>
+
+#define MAX_PLAIN 4096
+#define ROUNDS 4000
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                  \
+    do                                                    \
+    {                                                     \
+        if (!(cond))                                      \
+        {                                                 \
+            fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                 \
+            fputc('\n', stderr);                          \
+            failures++;                                   \
+        }                                                 \
+    } while (0)
+
+static const char *vector_name(void)
+{
+#if defined(BASE64_SSSE3)
+    return "ssse3";
+#elif defined(BASE64_NEON)
+    return "neon";
+#else
+    return "none";
+#endif
+}
+
+static BlockDecoder vector_decoder;
+
+static unsigned next_random(void)
+{
+    static unsigned state = 2463534242u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static int decode_with(BlockDecoder decoder, const char *input, size_t len, unsigned char *out, size_t cap)
+{
+    block_decoder = decoder;
+    return crypto_base64_decode(input, len, out, cap);
+}
+
+static void test_encode_matches_openssl(void)
+{
+    static unsigned char input[MAX_PLAIN];
+    static char ours[MAX_PLAIN * 2];
+    static unsigned char theirs[MAX_PLAIN * 2];
+
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        size_t len = next_random() % (MAX_PLAIN + 1);
+        for (size_t i = 0; i < len; i++)
+        {
+            input[i] = (unsigned char)next_random();
+        }
+
+        int encoded = crypto_base64_encode(input, len, ours, sizeof(ours));
+        int expected = EVP_EncodeBlock(theirs, input, (int)len);
+        CHECK(encoded == expected && memcmp(ours, theirs, (size_t)expected) == 0,
+              "length %zu encodes differently from OpenSSL", len);
+    }
+}
+
+static void test_paths_agree(void)
+{
+    static unsigned char input[MAX_PLAIN];
+    static char encoded[MAX_PLAIN * 2];
+    static unsigned char scalar[MAX_PLAIN + 16];
+    static unsigned char vector[MAX_PLAIN + 16];
+
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        size_t len = next_random() % (MAX_PLAIN + 1);
+        for (size_t i = 0; i < len; i++)
+        {
+            input[i] = (unsigned char)next_random();
+        }
+
+        size_t encoded_len = (size_t)crypto_base64_encode(input, len, encoded, sizeof(encoded));
+
+        // Every third round drops the padding; every fifth corrupts one
+        // character, which both paths must reject.
+        if (round % 3 == 0)
+        {
+            while (encoded_len > 0 && encoded[encoded_len - 1] == '=')
+            {
+                encoded_len--;
+            }
+        }
+        int corrupt = round % 5 == 0 && encoded_len > 0;
+        if (corrupt)
+        {
+            encoded[next_random() % encoded_len] = (char)(next_random() % 2 ? '*' : 0x80);
+        }
+
+        int a = decode_with(decode_blocks_none, encoded, encoded_len, scalar, sizeof(scalar));
+        int b = decode_with(vector_decoder, encoded, encoded_len, vector, sizeof(vector));
+
+        CHECK(a == b, "length %zu: scalar returned %d, %s returned %d", len, a, vector_name(), b);
+        if (corrupt || len == 0)
+        {
+            CHECK(a < 0, "length %zu: accepted %s input", len, corrupt ? "corrupt" : "empty");
+        }
+        else
+        {
+            CHECK(a == (int)len && memcmp(scalar, input, len) == 0, "length %zu: scalar did not round-trip", len);
+            CHECK(b == (int)len && memcmp(vector, input, len) == 0, "length %zu: %s did not round-trip", len,
+                  vector_name());
+        }
+    }
+}
+
+static void bench_decode(void)
+{
+    enum
+    {
+        SIZE = 48 * 1024,
+        ITERATIONS = 400
+    };
+    static unsigned char input[SIZE];
+    static char encoded[SIZE * 2];
+    static unsigned char out[SIZE + 16];
+
+    for (size_t i = 0; i < SIZE; i++)
+    {
+        input[i] = (unsigned char)next_random();
+    }
+    size_t encoded_len = (size_t)crypto_base64_encode(input, SIZE, encoded, sizeof(encoded));
+
+    struct
+    {
+        const char *name;
+        BlockDecoder decoder;
+    } paths[] = {{"scalar", decode_blocks_none}, {vector_name(), vector_decoder}};
+
+    for (size_t p = 0; p < sizeof(paths) / sizeof(paths[0]); p++)
+    {
+        double start = now_us();
+        for (int i = 0; i < ITERATIONS; i++)
+        {
+            decode_with(paths[p].decoder, encoded, encoded_len, out, sizeof(out));
+        }
+        double elapsed = now_us() - start;
+        printf("  base64 decode %-8s %8.1f MB/s\n", paths[p].name, (double)encoded_len * ITERATIONS / elapsed);
+    }
+
+    double start = now_us();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        EVP_DecodeBlock(out, (const unsigned char *)encoded, (int)encoded_len);
+    }
+    double elapsed = now_us() - start;
+    printf("  base64 decode %-8s %8.1f MB/s\n", "openssl", (double)encoded_len * ITERATIONS / elapsed);
+}
+
+// What every call did before native_crypto: a context allocated, keyed and
+// freed per decryption.
+static int decrypt_fresh_context(const unsigned char *ciphertext, int len, const unsigned char *key,
+                                 const unsigned char *iv, unsigned char *out)
+{
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    int out_len = 0, final_len = 0;
+    int ok = ctx != NULL && EVP_DecryptInit_ex(ctx, EVP_aes_128_cbc(), NULL, key, iv) == 1 &&
+             EVP_DecryptUpdate(ctx, out, &out_len, ciphertext, len) == 1 &&
+             EVP_DecryptFinal_ex(ctx, out + out_len, &final_len) == 1;
+    EVP_CIPHER_CTX_free(ctx);
+    return ok ? out_len + final_len : -1;
+}
+
+static void bench_decrypt(void)
+{
+    enum
+    {
+        ITERATIONS = 100000
+    };
+    const unsigned char key[16] = "0123456789abcdef";
+    const unsigned char iv[16] = "fedcba9876543210";
+    const char plaintext[] = "sk-0123456789abcdefghijklmnopqrstuvwxyz";
+
+    unsigned char ciphertext[64];
+    int len = 0, final_len = 0;
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    EVP_EncryptInit_ex(ctx, EVP_aes_128_cbc(), NULL, key, iv);
+    EVP_EncryptUpdate(ctx, ciphertext, &len, (const unsigned char *)plaintext, (int)strlen(plaintext));
+    EVP_EncryptFinal_ex(ctx, ciphertext + len, &final_len);
+    EVP_CIPHER_CTX_free(ctx);
+    len += final_len;
+
+    unsigned char out[64];
+    CHECK(crypto_aes_decrypt(ciphertext, (size_t)len, key, iv, out, sizeof(out)) == (int)strlen(plaintext) &&
+              strcmp((const char *)out, plaintext) == 0,
+          "crypto_aes_decrypt did not round-trip");
+
+    double start = now_us();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        crypto_aes_decrypt(ciphertext, (size_t)len, key, iv, out, sizeof(out));
+    }
+    double reused = (now_us() - start) * 1000.0 / ITERATIONS;
+
+    start = now_us();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        decrypt_fresh_context(ciphertext, len, key, iv, out);
+    }
+    double fresh = (now_us() - start) * 1000.0 / ITERATIONS;
+
+    printf("  aes-128-cbc per-thread context %6.0f ns/op, fresh context %6.0f ns/op\n", reused, fresh);
+}
+
+int main(void)
+{
+    pthread_once(&decoder_once, init_decoder);
+    vector_decoder = select_decoder();
+    printf("base64 vector path: %s\n", vector_name());
+
+    struct
+    {
+        const char *name;
+        void (*run)(void);
+    } tests[] = {
+        {"encode_matches_openssl", test_encode_matches_openssl},
+        {"paths_agree", test_paths_agree},
+        {"bench_decode", bench_decode},
+        {"bench_decrypt", bench_decrypt},
+    };
+
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+    {
+        int before = failures;
+        tests[i].run();
+        printf("%s %s\n", failures == before ? "ok" : "FAILED", tests[i].name);
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+// Builds protected_strings.c against a table generated by
+// protect_strings.cmake and checks that every definition in the source file
+// (PROTECTED_STRINGS_TXT) comes back unchanged from protected_string(), and
+// that equal plaintexts or shared prefixes are masked differently.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "protected_strings.h"
+#include "protected_string_data.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                  \
+    do                                                    \
+    {                                                     \
+        if (!(cond))                                      \
+        {                                                 \
+            fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                 \
+            fputc('\n', stderr);                          \
+            failures++;                                   \
+        }                                                 \
+    } while (0)
+
+static char *values[PS_COUNT];
+static int value_count = 0;
+
+// Same rules as protect_strings.cmake: '#' at the start of a line comments it
+// out, the first '=' splits name from value, CR is dropped.
+static void load_definitions(void)
+{
+    FILE *file = fopen(PROTECTED_STRINGS_TXT, "rb");
+    if (file == NULL)
+    {
+        CHECK(0, "cannot open %s", PROTECTED_STRINGS_TXT);
+        return;
+    }
+
+    char line[4096];
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        char *out = line;
+        for (char *in = line; *in != '\0'; in++)
+        {
+            if (*in != '\r' && *in != '\n')
+            {
+                *out++ = *in;
+            }
+        }
+        *out = '\0';
+
+        char *equals = strchr(line, '=');
+        if (line[0] == '#' || equals == NULL)
+        {
+            continue;
+        }
+        if (value_count == PS_COUNT)
+        {
+            CHECK(0, "more definitions than PS_COUNT (%d)", PS_COUNT);
+            break;
+        }
+        values[value_count++] = strdup(equals + 1);
+    }
+    fclose(file);
+}
+
+static void test_round_trip(void)
+{
+    CHECK(value_count == PS_COUNT, "%d definitions, PS_COUNT is %d", value_count, PS_COUNT);
+
+    for (int id = 0; id < value_count; id++)
+    {
+        const char *plain = protected_string((ProtectedStringId)id);
+        CHECK(plain != NULL && strcmp(plain, values[id]) == 0, "id %d: got '%s', expected '%s'", id,
+              plain ? plain : "NULL", values[id]);
+    }
+    CHECK(protected_string(PS_COUNT) == NULL, "an out-of-range id returned a value");
+}
+
+static size_t common_prefix(const char *a, const char *b)
+{
+    size_t n = 0;
+    while (a[n] != '\0' && a[n] == b[n])
+    {
+        n++;
+    }
+    return n;
+}
+
+// With one repeating key, 16 known bytes of any string give the key, and the
+// key unmasks every other string; equal plaintexts would also mask alike. A
+// keystream per string must resist both.
+static void test_equal_plaintexts_differ(void)
+{
+    int pairs = 0;
+    for (int a = 0; a < value_count; a++)
+    {
+        for (int b = a + 1; b < value_count; b++)
+        {
+            size_t shared = common_prefix(values[a], values[b]);
+            if (shared < 16)
+            {
+                continue;
+            }
+            pairs++;
+
+            const unsigned char *x = PROTECTED_DATA + PROTECTED_OFFSETS[a];
+            const unsigned char *y = PROTECTED_DATA + PROTECTED_OFFSETS[b];
+            CHECK(memcmp(x, y, shared) != 0, "ids %d and %d mask a %zu byte shared prefix alike", a, b, shared);
+
+            unsigned char key[16];
+            for (unsigned int i = 0; i < 16; i++)
+            {
+                key[(PROTECTED_OFFSETS[a] + i) % 16] = x[i] ^ (unsigned char)values[a][i];
+            }
+            int recovered = 1;
+            for (unsigned int i = 0; i < 16; i++)
+            {
+                recovered &= (y[i] ^ key[(PROTECTED_OFFSETS[b] + i) % 16]) == (unsigned char)values[b][i];
+            }
+            CHECK(!recovered, "the prefix of id %d unmasks id %d", a, b);
+        }
+    }
+    printf("  %d pair(s) with a shared prefix of 16+ bytes\n", pairs);
+}
+
+int main(void)
+{
+    load_definitions();
+
+    struct
+    {
+        const char *name;
+        void (*run)(void);
+    } tests[] = {
+        {"round_trip", test_round_trip},
+        {"equal_plaintexts_differ", test_equal_plaintexts_differ},
+    };
+
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+    {
+        int before = failures;
+        tests[i].run();
+        printf("%s %s\n", failures == before ? "ok" : "FAILED", tests[i].name);
+    }
+
+    return failures == 0 ? 0 : 1;
+}